@@ -0,0 +1,80 @@
+#define _GNU_SOURCE
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <flags/strings.h>
+
+volatile uint64_t BenchSink;
+
+uint64_t BenchNowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+bool BenchSelected(const BenchConfig *config, const char *name) {
+  return config->Filter == NULL || config->Filter[0] == '\0' ||
+         StringIsSubstringOf(config->Filter, strlen(config->Filter), name,
+                             strlen(name));
+}
+
+void BenchPrintHeader(const BenchConfig *config) {
+  printf("%-48s %12s %12s", "benchmark", "iters", "ns/op");
+  if (config->Perf.Enabled) {
+    printf(" %12s %12s %12s", "cycles/op", "instrs/op", "bmisses/op");
+  }
+  printf("\n");
+}
+
+void BenchRun(BenchConfig *config, const char *name, BenchFunc func,
+              void *ctx) {
+  BenchRunBytes(config, name, func, ctx, 0);
+}
+
+void BenchRunBytes(BenchConfig *config, const char *name, BenchFunc func,
+                   void *ctx, size_t bytes) {
+  if (!BenchSelected(config, name)) {
+    return;
+  }
+
+  // warm up caches and grow the iteration count until a single run covers
+  // the minimum measurement time
+  size_t iters = 1;
+  uint64_t elapsed = 0;
+  for (;;) {
+    const uint64_t start = BenchNowNs();
+    func(ctx, iters);
+    elapsed = BenchNowNs() - start;
+    if (elapsed >= config->MinTimeNs / 4) {
+      break;
+    }
+    iters *= 2;
+  }
+
+  const double scale = (double)config->MinTimeNs / (double)(elapsed + 1);
+  if (scale > 1.0) {
+    iters = (size_t)((double)iters * scale) + 1;
+  }
+
+  PerfStart(&config->Perf);
+  const uint64_t start = BenchNowNs();
+  func(ctx, iters);
+  elapsed = BenchNowNs() - start;
+  const PerfSample sample = PerfStop(&config->Perf);
+
+  const double n = (double)iters;
+  printf("%-48s %12zu %12.2f", name, iters, (double)elapsed / n);
+  if (config->Perf.Enabled) {
+    printf(" %12.2f %12.2f %12.4f", (double)sample.Cycles / n,
+           (double)sample.Instructions / n, (double)sample.BranchMisses / n);
+  }
+  if (bytes > 0) {
+    printf(" %9.2f GB/s", (double)bytes * n / (double)(elapsed + 1));
+  }
+  printf("\n");
+  fflush(stdout);
+}
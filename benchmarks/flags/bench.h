@@ -0,0 +1,32 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "perf.h"
+
+typedef void(BenchFunc)(void *ctx, size_t iters);
+
+typedef struct BenchConfig {
+  const char *Filter;
+  uint64_t MinTimeNs;
+  PerfCounters Perf;
+} BenchConfig;
+
+// BenchSink keeps the compiler from discarding benchmarked results.
+extern volatile uint64_t BenchSink;
+
+uint64_t BenchNowNs(void);
+bool BenchSelected(const BenchConfig *config, const char *name);
+void BenchPrintHeader(const BenchConfig *config);
+void BenchRun(BenchConfig *config, const char *name, BenchFunc func,
+              void *ctx);
+
+// BenchRunBytes is BenchRun for a func processing bytes bytes per
+// iteration, and also prints the throughput in GB/s.
+void BenchRunBytes(BenchConfig *config, const char *name, BenchFunc func,
+                   void *ctx, size_t bytes);
+
+#endif // BENCH_H_
@@ -0,0 +1,649 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <flags/flags.h>
+#include <flags/help.h>
+#include <flags/parse.h>
+#include <flags/schema.h>
+#include <flags/strings.h>
+#include <flags/suggest.h>
+
+#include "bench.h"
+
+#define BenchNameLen 32
+#define BenchValueLen 48
+
+typedef enum BenchValueType {
+  BenchBool,
+  BenchInt64,
+  BenchString,
+} BenchValueType;
+
+static const char *BenchValueTypeNames[] = {"bool", "int64", "string"};
+
+typedef struct BenchSchema {
+  BenchValueType Type;
+  size_t Len;
+  char *Names;
+  bool *Bools;
+  int64_t *Ints;
+  char *Strings;
+  FlagOption *Options;
+  struct option *LongOptions;
+  Flags Flags;
+} BenchSchema;
+
+typedef struct BenchArgs {
+  int Argc;
+  char **Argv;
+  char **Scratch;
+  char *Tokens;
+} BenchArgs;
+
+typedef struct BenchParseCtx {
+  BenchSchema *Schema;
+  BenchArgs *Args;
+} BenchParseCtx;
+
+static void BenchSchemaInit(BenchSchema *schema, BenchValueType type,
+                            size_t len) {
+  schema->Type = type;
+  schema->Len = len;
+  schema->Names = calloc(len, BenchNameLen);
+  schema->Bools = calloc(len, sizeof(bool));
+  schema->Ints = calloc(len, sizeof(int64_t));
+  schema->Strings = calloc(len, BenchValueLen);
+  schema->Options = calloc(len, sizeof(FlagOption));
+  schema->LongOptions = calloc(len + 1, sizeof(struct option));
+  if (!schema->Names || !schema->Bools || !schema->Ints ||
+      !schema->Strings || !schema->Options || !schema->LongOptions) {
+    abort();
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    char *name = schema->Names + i * BenchNameLen;
+    snprintf(name, BenchNameLen, "opt-%05zu", i);
+
+    switch (type) {
+    case BenchBool:
+      schema->Options[i] = FlagsNewBool(&schema->Bools[i], name, "bench");
+      break;
+    case BenchInt64:
+      schema->Options[i] = FlagsNewInt64(&schema->Ints[i], name, "bench");
+      break;
+    case BenchString:
+      schema->Options[i] =
+          FlagsNewString(schema->Strings + i * BenchValueLen, BenchValueLen,
+                         name, "bench");
+      break;
+    }
+
+    struct option *longOption = &schema->LongOptions[i];
+    longOption->name = name;
+    longOption->has_arg = type == BenchBool ? no_argument : required_argument;
+    longOption->flag = NULL;
+    longOption->val = 0;
+  }
+
+  FlagOptions options = {.OptionsLen = len, .Options = schema->Options};
+  schema->Flags = FlagsDefineOnlyOptions(options);
+}
+
+static void BenchSchemaRelease(BenchSchema *schema) {
+  FlagsRelease(&schema->Flags);
+  free(schema->Names);
+  free(schema->Bools);
+  free(schema->Ints);
+  free(schema->Strings);
+  free(schema->Options);
+  free(schema->LongOptions);
+}
+
+static void BenchArgsInit(BenchArgs *args, const BenchSchema *schema,
+                          size_t flagsLen) {
+  const size_t tokensPerFlag = schema->Type == BenchBool ? 1 : 2;
+  const size_t argc = 1 + flagsLen * tokensPerFlag;
+  args->Argc = (int)argc;
+  args->Argv = calloc(argc + 1, sizeof(char *));
+  args->Scratch = calloc(argc + 1, sizeof(char *));
+  args->Tokens = calloc(argc, BenchValueLen);
+  if (!args->Argv || !args->Scratch || !args->Tokens) {
+    abort();
+  }
+
+  args->Argv[0] = "bench";
+  for (size_t i = 0, j = 1; i < flagsLen; i++) {
+    // spread the lookups over the whole table
+    const size_t option = (i * 7919) % schema->Len;
+    char *flag = args->Tokens + j * BenchValueLen;
+    snprintf(flag, BenchValueLen, "-%s",
+             schema->Names + option * BenchNameLen);
+    args->Argv[j++] = flag;
+
+    if (tokensPerFlag == 2) {
+      char *value = args->Tokens + j * BenchValueLen;
+      snprintf(value, BenchValueLen, "%zu", 1000000 + i * 31);
+      args->Argv[j++] = value;
+    }
+  }
+}
+
+static void BenchArgsRelease(BenchArgs *args) {
+  free(args->Argv);
+  free(args->Scratch);
+  free(args->Tokens);
+}
+
+static void BenchFlagsParse(void *ctx, size_t iters) {
+  BenchParseCtx *bench = ctx;
+  for (size_t i = 0; i < iters; i++) {
+    int index = -1;
+    FlagError err = FlagsParse(bench->Args->Argc, bench->Args->Argv,
+                               &bench->Schema->Flags, &index);
+    if (err) {
+      abort();
+    }
+  }
+  BenchSink += (uint64_t)bench->Schema->Ints[0];
+}
+
+static void BenchGetoptLong(void *ctx, size_t iters) {
+  BenchParseCtx *bench = ctx;
+  BenchSchema *schema = bench->Schema;
+  BenchArgs *args = bench->Args;
+  for (size_t i = 0; i < iters; i++) {
+    // getopt may permute argv, so it works on a fresh copy every time
+    memcpy(args->Scratch, args->Argv, sizeof(char *) * (size_t)args->Argc);
+    optind = 0;
+    opterr = 0;
+
+    int longIndex = -1;
+    while (getopt_long_only(args->Argc, args->Scratch, "",
+                            schema->LongOptions, &longIndex) == 0) {
+      switch (schema->Type) {
+      case BenchBool:
+        schema->Bools[longIndex] = true;
+        break;
+      case BenchInt64:
+        schema->Ints[longIndex] = strtoll(optarg, NULL, 10);
+        break;
+      case BenchString:
+        StringCopy(schema->Strings + (size_t)longIndex * BenchValueLen,
+                   BenchValueLen - 1, optarg);
+        break;
+      }
+    }
+  }
+  BenchSink += (uint64_t)schema->Ints[0];
+}
+
+static void BenchParseGrid(BenchConfig *config) {
+  const size_t optionsLens[] = {10, 100, 1000, 10000};
+  const size_t flagsLens[] = {1, 16, 256};
+  char name[128];
+
+  for (int type = BenchBool; type <= BenchString; type++) {
+    for (size_t i = 0; i < sizeof(optionsLens) / sizeof(size_t); i++) {
+      BenchSchema schema;
+      BenchSchemaInit(&schema, (BenchValueType)type, optionsLens[i]);
+
+      for (size_t j = 0; j < sizeof(flagsLens) / sizeof(size_t); j++) {
+        BenchArgs args;
+        BenchArgsInit(&args, &schema, flagsLens[j]);
+        BenchParseCtx ctx = {.Schema = &schema, .Args = &args};
+        const char *typeName = BenchValueTypeNames[type];
+
+        snprintf(name, sizeof(name), "parse/linear/%s/opts=%zu/flags=%zu",
+                 typeName, optionsLens[i], flagsLens[j]);
+        BenchRun(config, name, BenchFlagsParse, &ctx);
+
+        snprintf(name, sizeof(name), "parse/compiled/%s/opts=%zu/flags=%zu",
+                 typeName, optionsLens[i], flagsLens[j]);
+        if (BenchSelected(config, name)) {
+          if (FlagsCompile(&schema.Flags)) {
+            abort();
+          }
+          BenchRun(config, name, BenchFlagsParse, &ctx);
+          FlagsRelease(&schema.Flags);
+        }
+
+        snprintf(name, sizeof(name), "parse/lazy/%s/opts=%zu/flags=%zu",
+                 typeName, optionsLens[i], flagsLens[j]);
+        if (BenchSelected(config, name)) {
+          if (FlagsCompile(&schema.Flags)) {
+            abort();
+          }
+          schema.Flags.Lazy = true;
+          BenchRun(config, name, BenchFlagsParse, &ctx);
+          schema.Flags.Lazy = false;
+          FlagsRelease(&schema.Flags);
+        }
+
+        snprintf(name, sizeof(name), "parse/getopt_long/%s/opts=%zu/flags=%zu",
+                 typeName, optionsLens[i], flagsLens[j]);
+        BenchRun(config, name, BenchGetoptLong, &ctx);
+
+        BenchArgsRelease(&args);
+      }
+
+      BenchSchemaRelease(&schema);
+    }
+  }
+}
+
+typedef struct BenchStringCtx {
+  const char *Value;
+  size_t Len;
+  const char *Pattern;
+  size_t PatternLen;
+} BenchStringCtx;
+
+static void BenchStringToInt64(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    const char *endptr = NULL;
+    sum += (uint64_t)StringToInt64(bench->Value, bench->Len, &endptr, 10);
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringToUint64(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    const char *endptr = NULL;
+    sum += StringToUint64(bench->Value, bench->Len, &endptr, 10);
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringParseInt64(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    int64_t value = 0;
+    sum += StringParseInt64(bench->Value, bench->Len, &value, NULL);
+    sum += (uint64_t)value;
+  }
+  BenchSink += sum;
+}
+
+static void BenchStrtod(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  double sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    sum += strtod(bench->Value, NULL);
+  }
+  BenchSink += (uint64_t)sum;
+}
+
+static void BenchStringParseDouble(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  double sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    double value = 0;
+    StringParseDouble(bench->Value, bench->Len, &value, NULL);
+    sum += value;
+  }
+  BenchSink += (uint64_t)sum;
+}
+
+static void BenchParseBool(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    bool value = false;
+    sum += ParseBool(&value, bench->Value, bench->Len) + value;
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringIsSubstringOf(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    sum += StringIsSubstringOf(bench->Pattern, bench->PatternLen,
+                               bench->Value, bench->Len);
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringSkipBlank(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    sum += (uint64_t)(StringSkipBlank(bench->Value, bench->Len) -
+                      bench->Value);
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringSkipLine(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    sum += (uint64_t)(StringSkipLine(bench->Value, bench->Len) - bench->Value);
+  }
+  BenchSink += sum;
+}
+
+static void BenchStringSkipChar(void *ctx, size_t iters) {
+  BenchStringCtx *bench = ctx;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    sum += (uint64_t)(StringSkipChar(bench->Value, bench->Len, CharIsBlank) -
+                      bench->Value);
+  }
+  BenchSink += sum;
+}
+
+// BenchScanners measures the character class scanners over a 1 MiB run of
+// blanks, as found in indented config files, against the per byte skipper.
+static void BenchScanners(BenchConfig *config) {
+  const size_t len = (size_t)1 << 20;
+  char *text = malloc(len);
+  if (!text) {
+    abort();
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    text[i] = " \t \r"[i % 4];
+  }
+  text[len - 1] = 'x';
+
+  BenchStringCtx ctx = {.Value = text, .Len = len};
+  BenchRunBytes(config, "string/StringSkipChar/1MiB", BenchStringSkipChar,
+                &ctx, len);
+  BenchRunBytes(config, "string/StringSkipBlank/1MiB", BenchStringSkipBlank,
+                &ctx, len);
+
+  memset(text, 'x', len);
+  text[len - 1] = '\n';
+  BenchRunBytes(config, "string/StringSkipLine/1MiB", BenchStringSkipLine,
+                &ctx, len);
+  free(text);
+}
+
+static void BenchPrimitives(BenchConfig *config) {
+  BenchStringCtx ctx;
+  const struct {
+    const char *Name;
+    BenchFunc *Func;
+    const char *Value;
+  } cases[] = {
+      {"string/StringToInt64/short", BenchStringToInt64, "-42"},
+      {"string/StringToInt64/long", BenchStringToInt64, "-9123456789012345"},
+      {"string/StringParseInt64/short", BenchStringParseInt64, "-42"},
+      {"string/StringParseInt64/long", BenchStringParseInt64,
+       "-9123456789012345"},
+      {"string/StringToUint64/short", BenchStringToUint64, "42"},
+      {"string/StringToUint64/long", BenchStringToUint64,
+       "18446744073709551615"},
+      {"string/strtod/short", BenchStrtod, "0.75"},
+      {"string/strtod/long", BenchStrtod, "2.2250738585072011e-308"},
+      {"string/StringParseDouble/short", BenchStringParseDouble, "0.75"},
+      {"string/StringParseDouble/long", BenchStringParseDouble,
+       "2.2250738585072011e-308"},
+      {"parse/ParseBool/true", BenchParseBool, "true"},
+      {"parse/ParseBool/disabled", BenchParseBool, "disabled"},
+      {"parse/ParseBool/numeric", BenchParseBool, "1"},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    ctx.Value = cases[i].Value;
+    ctx.Len = strlen(cases[i].Value);
+    BenchRun(config, cases[i].Name, cases[i].Func, &ctx);
+  }
+
+  char text[256];
+  memset(text, 'a', sizeof(text));
+  memcpy(text + sizeof(text) - 8, "needle!!", 8);
+  ctx.Value = text;
+  ctx.Len = sizeof(text);
+  ctx.Pattern = "needle";
+  ctx.PatternLen = 6;
+  BenchRun(config, "string/StringIsSubstringOf/256", BenchStringIsSubstringOf,
+           &ctx);
+
+  char blanks[256];
+  memset(blanks, ' ', sizeof(blanks));
+  blanks[sizeof(blanks) - 1] = 'x';
+  ctx.Value = blanks;
+  ctx.Len = sizeof(blanks);
+  BenchRun(config, "string/StringSkipBlank/256", BenchStringSkipBlank, &ctx);
+}
+
+typedef struct BenchHelpCtx {
+  HelpItem *Items;
+  size_t Len;
+} BenchHelpCtx;
+
+static void BenchPrintHelpItems(void *ctx, size_t iters) {
+  BenchHelpCtx *bench = ctx;
+  for (size_t i = 0; i < iters; i++) {
+    PrintHelpItems(bench->Items, bench->Len, "\t-");
+  }
+}
+
+typedef struct BenchFormatHelpCtx {
+  BenchSchema *Schema;
+  char *Buf;
+  size_t Cap;
+} BenchFormatHelpCtx;
+
+static void BenchFormatHelp(void *ctx, size_t iters) {
+  BenchFormatHelpCtx *bench = ctx;
+  for (size_t i = 0; i < iters; i++) {
+    BenchSink += FlagsFormatHelp(bench->Buf, bench->Cap, "bench",
+                                 &bench->Schema->Flags, NULL);
+  }
+}
+
+static void BenchFormatHelpLarge(BenchConfig *config) {
+  const char *name = "help/FlagsFormatHelp/10000";
+  if (!BenchSelected(config, name)) {
+    return;
+  }
+
+  BenchSchema schema;
+  BenchSchemaInit(&schema, BenchInt64, 10000);
+  const size_t cap =
+      FlagsFormatHelp(NULL, 0, "bench", &schema.Flags, NULL) + 1;
+  BenchFormatHelpCtx ctx = {.Schema = &schema, .Buf = malloc(cap), .Cap = cap};
+  if (!ctx.Buf) {
+    abort();
+  }
+
+  BenchRun(config, name, BenchFormatHelp, &ctx);
+  free(ctx.Buf);
+  BenchSchemaRelease(&schema);
+}
+
+typedef struct BenchSuggestCtx {
+  Flags *Flags;
+  const char *Token;
+} BenchSuggestCtx;
+
+static void BenchSuggest(void *ctx, size_t iters) {
+  BenchSuggestCtx *bench = ctx;
+  FlagSuggestion out[FlagsMaxSuggestions];
+  for (size_t i = 0; i < iters; i++) {
+    BenchSink += FlagsSuggest(bench->Flags, bench->Token, out,
+                              FlagsMaxSuggestions);
+  }
+}
+
+static void BenchSuggestLarge(BenchConfig *config) {
+  const char *name = "suggest/FlagsSuggest/10000";
+  if (!BenchSelected(config, name)) {
+    return;
+  }
+
+  BenchSchema schema;
+  BenchSchemaInit(&schema, BenchInt64, 10000);
+  // a misspelling of a name in the middle of the table
+  char token[BenchNameLen + 1] = "-";
+  strcpy(token + 1, schema.Options[schema.Len / 2].Help.Name);
+  token[3] ^= 1;
+  BenchSuggestCtx ctx = {.Flags = &schema.Flags, .Token = token};
+  BenchRun(config, name, BenchSuggest, &ctx);
+  BenchSchemaRelease(&schema);
+}
+
+static void BenchHelp(BenchConfig *config) {
+  const char *name = "help/PrintHelpItems/100";
+  if (!BenchSelected(config, name)) {
+    return;
+  }
+
+  BenchSchema schema;
+  BenchSchemaInit(&schema, BenchInt64, 100);
+  HelpItem *items = calloc(schema.Len, sizeof(HelpItem));
+  if (!items) {
+    abort();
+  }
+  for (size_t i = 0; i < schema.Len; i++) {
+    items[i] = schema.Options[i].Help;
+  }
+
+  // help goes to stderr, which is pointed at /dev/null while measuring
+  fflush(stderr);
+  const int saved = dup(STDERR_FILENO);
+  const int devnull = open("/dev/null", O_WRONLY);
+  if (saved < 0 || devnull < 0) {
+    abort();
+  }
+  dup2(devnull, STDERR_FILENO);
+
+  BenchHelpCtx ctx = {.Items = items, .Len = schema.Len};
+  BenchRun(config, name, BenchPrintHelpItems, &ctx);
+
+  fflush(stderr);
+  dup2(saved, STDERR_FILENO);
+  close(devnull);
+  close(saved);
+  free(items);
+  BenchSchemaRelease(&schema);
+}
+
+#define BENCH_SCHEMA(X, S)                                                     \
+  X(S, Int64, port, "port", "port", 0)                                         \
+  X(S, Int64, conns, "conns", "connections", 0)                                \
+  X(S, Int64, retries, "retries", "retries", 0)                                \
+  X(S, Int64, backlog, "backlog", "backlog", 0)                                \
+  X(S, Int64, workers, "workers", "workers", 0)                                \
+  X(S, Int64, threads, "threads", "threads", 0)                                \
+  X(S, Int64, queue, "queue", "queue", 0)                                      \
+  X(S, Int64, shards, "shards", "shards", 0)
+
+FlagsSchemaDeclare(BenchSchemaFlags, BENCH_SCHEMA)
+
+static char *BenchSchemaArgv[] = {
+    "bench",
+    "-port",    "8080", "-conns",   "64",  "-retries", "3",
+    "-backlog", "128",  "-workers", "8",   "-threads", "16",
+    "-queue",   "1024", "-shards",  "4",
+};
+
+static void BenchSchemaParse(void *ctx, size_t iters) {
+  (void)ctx;
+  const int argc = sizeof(BenchSchemaArgv) / sizeof(BenchSchemaArgv[0]);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    BenchSchemaFlags config = BenchSchemaFlagsDefaults;
+    int index = -1;
+    sum += BenchSchemaFlagsParse(&config, argc, BenchSchemaArgv, &index);
+    sum += (uint64_t)config.shards;
+  }
+  BenchSink += sum;
+}
+
+static void BenchSchemaRuntime(void *ctx, size_t iters) {
+  Flags *flags = ctx;
+  const int argc = sizeof(BenchSchemaArgv) / sizeof(BenchSchemaArgv[0]);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; i++) {
+    int index = -1;
+    sum += FlagsParse(argc, BenchSchemaArgv, flags, &index);
+  }
+  BenchSink += sum;
+}
+
+static void BenchSchemaDispatch(BenchConfig *config) {
+  BenchSchemaFlags values = BenchSchemaFlagsDefaults;
+  FlagOption options[BenchSchemaFlagsSchemaLen];
+  for (size_t i = 0; i < BenchSchemaFlagsSchemaLen; i++) {
+    const FlagsSchemaEntry *entry = &BenchSchemaFlagsSchema[i];
+    options[i] = FlagsNewInt64(
+        (int64_t *)((char *)&values + entry->Offset), entry->Help.Name,
+        entry->Help.Help);
+  }
+
+  FlagOptions declared = {.OptionsLen = BenchSchemaFlagsSchemaLen,
+                          .Options = options};
+  Flags flags = FlagsDefineOnlyOptions(declared);
+  if (FlagsCompile(&flags)) {
+    abort();
+  }
+
+  BenchRun(config, "parse/schema/generated/opts=8", BenchSchemaParse, NULL);
+  BenchRun(config, "parse/schema/compiled/opts=8", BenchSchemaRuntime,
+           &flags);
+  FlagsRelease(&flags);
+}
+
+int main(int argc, char *argv[]) {
+  char filter[64] = "";
+  uint64_t minTimeMs = 50;
+  bool counters = false;
+  bool help = false;
+  int index = -1;
+  FlagOptionsDeclare(
+      options,
+      FlagsNewString(filter, sizeof(filter), "filter",
+                     "only run benchmarks whose name contains this value"),
+      FlagsNewUint64(&minTimeMs, "min-time-ms",
+                     "minimum measured time per benchmark"),
+      FlagsNewBool(&counters, "counters",
+                   "read hardware counters through perf_event_open"),
+      FlagsNewBool(&help, "help", "print this help"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+  if (err) {
+    FlagsReportError(&flags, argc, argv, err, index);
+    return EXIT_FAILURE;
+  }
+
+  if (help) {
+    FlagsPrintHelp(argv[0], &flags);
+    return EXIT_SUCCESS;
+  }
+
+  BenchConfig config = {.Filter = filter, .MinTimeNs = minTimeMs * 1000000};
+  config.Perf.Enabled = false;
+  if (counters && !PerfOpen(&config.Perf)) {
+    fprintf(stderr, "%s: hardware counters unavailable\n", argv[0]);
+  }
+
+  BenchPrintHeader(&config);
+  BenchPrimitives(&config);
+  BenchScanners(&config);
+  BenchHelp(&config);
+  BenchFormatHelpLarge(&config);
+  BenchSuggestLarge(&config);
+  BenchParseGrid(&config);
+  BenchSchemaDispatch(&config);
+
+  if (config.Perf.Enabled) {
+    PerfClose(&config.Perf);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#define _GNU_SOURCE
+
+#include "perf.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static int PerfOpenEvent(uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+bool PerfOpen(PerfCounters *counters) {
+  const uint64_t configs[PerfCountersLen] = {PERF_COUNT_HW_CPU_CYCLES,
+                                             PERF_COUNT_HW_INSTRUCTIONS,
+                                             PERF_COUNT_HW_BRANCH_MISSES};
+  counters->Enabled = false;
+  for (int i = 0; i < PerfCountersLen; i++) {
+    counters->Fds[i] = -1;
+  }
+
+  for (int i = 0; i < PerfCountersLen; i++) {
+    counters->Fds[i] = PerfOpenEvent(configs[i], counters->Fds[0]);
+    if (counters->Fds[i] < 0) {
+      PerfClose(counters);
+      return false;
+    }
+  }
+
+  counters->Enabled = true;
+  return true;
+}
+
+void PerfStart(PerfCounters *counters) {
+  if (!counters->Enabled) {
+    return;
+  }
+
+  ioctl(counters->Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(counters->Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfSample PerfStop(PerfCounters *counters) {
+  PerfSample sample = {0};
+  if (!counters->Enabled) {
+    return sample;
+  }
+
+  ioctl(counters->Fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  // PERF_FORMAT_GROUP layout: the number of events followed by their values
+  uint64_t values[1 + PerfCountersLen] = {0};
+  if (read(counters->Fds[0], values, sizeof(values)) ==
+      (ssize_t)sizeof(values)) {
+    sample.Cycles = values[1];
+    sample.Instructions = values[2];
+    sample.BranchMisses = values[3];
+  }
+
+  return sample;
+}
+
+void PerfClose(PerfCounters *counters) {
+  for (int i = PerfCountersLen - 1; i >= 0; i--) {
+    if (counters->Fds[i] >= 0) {
+      close(counters->Fds[i]);
+      counters->Fds[i] = -1;
+    }
+  }
+  counters->Enabled = false;
+}
+
+#else
+
+bool PerfOpen(PerfCounters *counters) {
+  for (int i = 0; i < PerfCountersLen; i++) {
+    counters->Fds[i] = -1;
+  }
+  counters->Enabled = false;
+  return false;
+}
+
+void PerfStart(PerfCounters *counters) { (void)counters; }
+
+PerfSample PerfStop(PerfCounters *counters) {
+  (void)counters;
+  PerfSample sample = {0};
+  return sample;
+}
+
+void PerfClose(PerfCounters *counters) { (void)counters; }
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef PERF_H_
+#define PERF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PerfCountersLen 3
+
+typedef struct PerfSample {
+  uint64_t Cycles;
+  uint64_t Instructions;
+  uint64_t BranchMisses;
+} PerfSample;
+
+// PerfCounters reads hardware counters for the calling thread through
+// perf_event_open. When the kernel or the CPU does not expose them the
+// counters stay disabled and every sample reads as zero.
+typedef struct PerfCounters {
+  bool Enabled;
+  int Fds[PerfCountersLen];
+} PerfCounters;
+
+bool PerfOpen(PerfCounters *counters);
+void PerfStart(PerfCounters *counters);
+PerfSample PerfStop(PerfCounters *counters);
+void PerfClose(PerfCounters *counters);
+
+#endif // PERF_H_
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "buffer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "strings.h"
+
+#define FlagsMaxBatchThreads 64
+
+typedef struct FlagsBufferToken {
+  const char *Ptr;
+  size_t Len;
+} FlagsBufferToken;
+
+static bool FlagsBufferNext(const char **c, const char *end,
+                            FlagsBufferToken *token) {
+  if (*c >= end) {
+    return false;
+  }
+
+  const char *sep = StringFindChar(*c, (size_t)(end - *c), '\0');
+  token->Ptr = *c;
+  token->Len = (size_t)(sep - *c);
+  *c = sep < end ? sep + 1 : end;
+  return true;
+}
+
+typedef struct FlagsBufferParser {
+  const Flags *Flags;
+  const FlagsRecord *Record;
+  FlagsSeenSet Seen;
+  const char *Next;
+  const char *End;
+  int *Index;
+  int Pos;
+} FlagsBufferParser;
+
+static FlagError FlagsBufferApply(void *ctx, FlagOption *option,
+                                  const char *s, size_t len) {
+  FlagsBufferParser *parser = ctx;
+  bool apply = true;
+  FlagError err = FlagsSeenAdd(parser->Flags, &parser->Seen, option, &apply);
+  if (err || !apply) {
+    return err;
+  }
+  return FlagsApplyOptionTo(option, parser->Record, s, len);
+}
+
+static bool FlagsBufferValue(void *ctx, const char **s, size_t *len) {
+  FlagsBufferParser *parser = ctx;
+  FlagsBufferToken token;
+  if (!FlagsBufferNext(&parser->Next, parser->End, &token)) {
+    return false;
+  }
+
+  *parser->Index = ++parser->Pos;
+  *s = token.Ptr;
+  *len = token.Len;
+  return true;
+}
+
+static FlagError FlagsBufferParse(FlagsBufferParser *parser) {
+  const Flags *flags = parser->Flags;
+  FlagArgReader reader = {
+      .Apply = FlagsBufferApply, .Next = FlagsBufferValue, .Ctx = parser};
+  FlagsBufferToken token;
+
+  // the first argument is the program name
+  if (!FlagsBufferNext(&parser->Next, parser->End, &token)) {
+    return Ok;
+  }
+
+  while (FlagsBufferNext(&parser->Next, parser->End, &token)) {
+    *parser->Index = ++parser->Pos;
+    if (token.Len == 0 || token.Ptr[0] != '-') {
+      // a command ends parsing as it does for FlagsParse
+      return FlagsApplyCommandTo(flags, parser->Record, token.Ptr,
+                                 token.Len);
+    }
+
+    if (token.Len == 2 && token.Ptr[1] == '-') {
+      *parser->Index = parser->Pos + 1;
+      return Ok;
+    }
+
+    const FlagArg arg = FlagsSplitArg(token.Ptr, token.Len);
+    FlagOption *option = FlagsLookupOption(flags, arg.Name, arg.NameLen);
+    FlagError err = FlagsApplyArg(flags, &arg, option, &reader);
+    if (err) {
+      return err;
+    }
+  }
+
+  return Ok;
+}
+
+FlagError FlagsParseBuffer(const Flags *flags, const char *buf, size_t len,
+                           const FlagsRecord *record, int *index) {
+  FlagsBufferParser parser = {.Flags = flags,
+                              .Record = record,
+                              .Next = buf,
+                              .End = buf + len,
+                              .Index = index,
+                              .Pos = 0};
+  FlagError err = FlagsSeenInit(&parser.Seen, flags);
+  if (err) {
+    return err;
+  }
+
+  err = FlagsBufferParse(&parser);
+  if (!err) {
+    int errorOption = -1;
+    err = FlagsSeenCheck(flags, &parser.Seen, &errorOption);
+  }
+
+  FlagsSeenRelease(&parser.Seen);
+  return err;
+}
+
+typedef struct FlagsBatch {
+  const Flags *Flags;
+  const void *Proto;
+  size_t Size;
+  FlagsBatchItem *Items;
+  size_t Len;
+  atomic_size_t Next;
+} FlagsBatch;
+
+static void *FlagsBatchWorker(void *arg) {
+  FlagsBatch *batch = arg;
+  for (;;) {
+    const size_t i =
+        atomic_fetch_add_explicit(&batch->Next, 1, memory_order_relaxed);
+    if (i >= batch->Len) {
+      return NULL;
+    }
+
+    FlagsBatchItem *item = &batch->Items[i];
+    const FlagsRecord record = {
+        .Proto = batch->Proto, .Size = batch->Size, .Base = item->Record};
+    item->Index = -1;
+    item->Err = FlagsParseBuffer(batch->Flags, item->Buffer, item->Len,
+                                 &record, &item->Index);
+  }
+}
+
+FlagError FlagsParseBatch(const Flags *flags, const void *proto, size_t size,
+                          FlagsBatchItem *items, size_t len, int threads) {
+  FlagsBatch batch = {.Flags = flags,
+                      .Proto = proto,
+                      .Size = size,
+                      .Items = items,
+                      .Len = len};
+  atomic_init(&batch.Next, 0);
+
+  if (threads > FlagsMaxBatchThreads) {
+    threads = FlagsMaxBatchThreads;
+  }
+  if ((size_t)threads > len) {
+    threads = (int)len;
+  }
+
+  // the calling thread works too, so only threads - 1 workers are started
+  pthread_t workers[FlagsMaxBatchThreads];
+  int started = 0;
+  while (started < threads - 1 &&
+         pthread_create(&workers[started], NULL, FlagsBatchWorker, &batch) ==
+             0) {
+    started++;
+  }
+
+  FlagsBatchWorker(&batch);
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  return Ok;
+}
@@ -0,0 +1,35 @@
+#ifndef FLAGS_BUFFER_H_
+#define FLAGS_BUFFER_H_
+
+#include <stddef.h>
+
+#include "flags.h"
+
+// FlagsParseBuffer parses a buffer of '\0' separated arguments laid out like
+// /proc/<pid>/cmdline, the first one being the program name. Values are
+// written through record when it is not NULL, which leaves flags untouched
+// so one compiled Flags can be shared by many threads. On error index is
+// set to the position of the offending argument. Arguments follow the
+// syntax of FlagsParse, except for response files, and the required
+// options and rules of flags are checked once they are all parsed.
+FlagError FlagsParseBuffer(const Flags *flags, const char *buf, size_t len,
+                           const FlagsRecord *record, int *index);
+
+typedef struct FlagsBatchItem {
+  const char *Buffer;
+  size_t Len;
+  void *Record;
+  FlagError Err;
+  int Index;
+} FlagsBatchItem;
+
+// FlagsParseBatch parses every item with FlagsParseBuffer into its own
+// Record, a copy of the size bytes at proto that the option values point
+// into, spreading the items over up to threads worker threads. Records
+// must be initialized by the caller, and list options get their own copy
+// of the elements as described for FlagsRecord. The result of every item is
+// stored in its Err and Index.
+FlagError FlagsParseBatch(const Flags *flags, const void *proto, size_t size,
+                          FlagsBatchItem *items, size_t len, int threads);
+
+#endif // FLAGS_BUFFER_H_
@@ -0,0 +1,390 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "cell.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "strings.h"
+
+#define FlagsControlLineLen 4096
+
+FlagOption FlagsNewAtomicBool(atomic_bool *value, const char *name,
+                              const char *help) {
+  FlagOption option = {.Type = FlagAtomicBool,
+                       .NumArgs = 0,
+                       .ParseFunc = &ParseFuncAtomicBool,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewAtomicInt32(_Atomic int32_t *value, const char *name,
+                               const char *help) {
+  FlagOption option = {.Type = FlagAtomicInt32,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncAtomicInt32,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewAtomicInt64(_Atomic int64_t *value, const char *name,
+                               const char *help) {
+  FlagOption option = {.Type = FlagAtomicInt64,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncAtomicInt64,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewAtomicUint32(_Atomic uint32_t *value, const char *name,
+                                const char *help) {
+  FlagOption option = {.Type = FlagAtomicUint32,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncAtomicUint32,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewAtomicUint64(_Atomic uint64_t *value, const char *name,
+                                const char *help) {
+  FlagOption option = {.Type = FlagAtomicUint64,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncAtomicUint64,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewAtomicString(FlagCellString *value, const char *name,
+                                const char *help) {
+  if (value->Cap == 0) {
+    // a cell needs room for at least the terminator
+    abort();
+  }
+
+  FlagOption option = {.Type = FlagAtomicString,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncAtomicString,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = value->Cap};
+  return option;
+}
+
+size_t FlagCellLoadString(FlagCellString *cell, char *out, size_t cap) {
+  if (cap == 0 || cell->Cap == 0) {
+    return 0;
+  }
+
+  for (;;) {
+    const unsigned begin =
+        atomic_load_explicit(&cell->Seq, memory_order_acquire);
+    if (begin & 1) {
+      continue;
+    }
+
+    // Len may be torn while a writer runs, so it is clamped before use and
+    // the copy is discarded unless Seq did not move
+    size_t len = cell->Len;
+    if (len >= cell->Cap) {
+      len = cell->Cap - 1;
+    }
+
+    const size_t n = len < cap ? len : cap - 1;
+    memcpy(out, cell->Value, n);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&cell->Seq, memory_order_relaxed) == begin) {
+      out[n] = 0;
+      return len;
+    }
+  }
+}
+
+bool FlagCellStoreString(FlagCellString *cell, const char *s, size_t len) {
+  if (len >= cell->Cap) {
+    return false;
+  }
+
+  // writers take the lock by moving Seq from even to odd
+  unsigned seq = atomic_load_explicit(&cell->Seq, memory_order_relaxed);
+  for (;;) {
+    if (seq & 1) {
+      seq = atomic_load_explicit(&cell->Seq, memory_order_relaxed);
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&cell->Seq, &seq, seq + 1,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  atomic_thread_fence(memory_order_release);
+  memcpy(cell->Value, s, len);
+  cell->Value[len] = 0;
+  cell->Len = len;
+  atomic_store_explicit(&cell->Seq, seq + 2, memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicBool(void *value, size_t maxLen, const char *s,
+                         size_t len) {
+  (void)maxLen;
+  bool parsed;
+  if (!ParseBool(&parsed, s, len)) {
+    return false;
+  }
+
+  atomic_store_explicit((atomic_bool *)value, parsed, memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicInt32(void *value, size_t maxLen, const char *s,
+                          size_t len) {
+  (void)maxLen;
+  int32_t parsed;
+  if (!ParseInt32(&parsed, s, len)) {
+    return false;
+  }
+
+  atomic_store_explicit((_Atomic int32_t *)value, parsed,
+                        memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicInt64(void *value, size_t maxLen, const char *s,
+                          size_t len) {
+  (void)maxLen;
+  int64_t parsed;
+  if (!ParseInt64(&parsed, s, len)) {
+    return false;
+  }
+
+  atomic_store_explicit((_Atomic int64_t *)value, parsed,
+                        memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicUint32(void *value, size_t maxLen, const char *s,
+                           size_t len) {
+  (void)maxLen;
+  uint32_t parsed;
+  if (!ParseUint32(&parsed, s, len)) {
+    return false;
+  }
+
+  atomic_store_explicit((_Atomic uint32_t *)value, parsed,
+                        memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicUint64(void *value, size_t maxLen, const char *s,
+                           size_t len) {
+  (void)maxLen;
+  uint64_t parsed;
+  if (!ParseUint64(&parsed, s, len)) {
+    return false;
+  }
+
+  atomic_store_explicit((_Atomic uint64_t *)value, parsed,
+                        memory_order_release);
+  return true;
+}
+
+bool ParseFuncAtomicString(void *value, size_t maxLen, const char *s,
+                           size_t len) {
+  (void)maxLen;
+  return FlagCellStoreString(value, s, len);
+}
+
+static bool FlagIsCell(FlagType type) {
+  switch (type) {
+  case FlagAtomicBool:
+  case FlagAtomicInt32:
+  case FlagAtomicInt64:
+  case FlagAtomicUint32:
+  case FlagAtomicUint64:
+  case FlagAtomicString:
+    return true;
+  default:
+    return false;
+  }
+}
+
+FlagError FlagsControlOpen(FlagsControl *control, Flags *flags,
+                           const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  const size_t len = strlen(path);
+  if (len >= sizeof(addr.sun_path)) {
+    return FlagErrControl;
+  }
+  memcpy(addr.sun_path, path, len + 1);
+
+  control->Flags = flags;
+  control->Fd = -1;
+  control->Path = NULL;
+  atomic_init(&control->Generation, 0);
+
+  // a socket left behind by a previous process would make bind fail
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+
+  control->Path = strdup(path);
+  if (!control->Path) {
+    return FlagErrNoMemory;
+  }
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    free(control->Path);
+    control->Path = NULL;
+    return FlagErrControl;
+  }
+
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+    // path is not ours to unlink when bind fails
+    close(fd);
+    free(control->Path);
+    control->Path = NULL;
+    return FlagErrControl;
+  }
+
+  control->Fd = fd;
+  if (listen(fd, 4)) {
+    FlagsControlClose(control);
+    return FlagErrControl;
+  }
+
+  return Ok;
+}
+
+FlagError FlagsControlApply(FlagsControl *control, const char *line,
+                            size_t len) {
+  while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+    len--;
+  }
+
+  const char *eq = StringFindChar(line, len, '=');
+  if (eq == line + len) {
+    return FlagErrNoArg;
+  }
+
+  const size_t nameLen = (size_t)(eq - line);
+  FlagOption *option = FlagsLookupOption(control->Flags, line, nameLen);
+  if (!option) {
+    return FlagErrUnknownFlag;
+  }
+
+  if (!FlagIsCell(option->Type)) {
+    // only cells can be changed safely while readers are running
+    return FlagErrType;
+  }
+
+  FlagError err = FlagsApplyOption(option, eq + 1, len - nameLen - 1);
+  if (err) {
+    return err;
+  }
+
+  atomic_fetch_add_explicit(&control->Generation, 1, memory_order_release);
+  return Ok;
+}
+
+static bool FlagsControlReply(int fd, FlagError err) {
+  char reply[128];
+  size_t len;
+
+  if (err) {
+    len = (size_t)snprintf(reply, sizeof(reply), "error: %s\n",
+                           FlagErrorToString(err));
+  } else {
+    len = (size_t)snprintf(reply, sizeof(reply), "ok\n");
+  }
+
+  return write(fd, reply, len) == (ssize_t)len;
+}
+
+FlagError FlagsControlServe(FlagsControl *control, int timeoutMs) {
+  struct pollfd pfd = {.fd = control->Fd, .events = POLLIN};
+  if (poll(&pfd, 1, timeoutMs) <= 0) {
+    return Ok;
+  }
+
+  const int fd = accept(control->Fd, NULL, NULL);
+  if (fd < 0) {
+    return FlagErrControl;
+  }
+
+  char buf[FlagsControlLineLen];
+  size_t used = 0;
+  FlagError result = Ok;
+
+  pfd.fd = fd;
+  while (!result && poll(&pfd, 1, timeoutMs) > 0) {
+
+    const ssize_t n = read(fd, buf + used, sizeof(buf) - used);
+    if (n <= 0) {
+      break;
+    }
+    used += (size_t)n;
+
+    size_t start = 0;
+    while (!result) {
+      const char *nl = StringFindChar(buf + start, used - start, '\n');
+      if (nl == buf + used) {
+        break;
+      }
+
+      const size_t lineLen = (size_t)(nl - buf) - start;
+      const FlagError err = FlagsControlApply(control, buf + start, lineLen);
+      if (!FlagsControlReply(fd, err)) {
+        result = FlagErrControl;
+      }
+      start += lineLen + 1;
+    }
+
+    memmove(buf, buf + start, used - start);
+    used -= start;
+    if (used == sizeof(buf)) {
+      // no line fits in the buffer
+      FlagsControlReply(fd, FlagErrParse);
+      result = FlagErrControl;
+    }
+  }
+
+  close(fd);
+  return result;
+}
+
+void FlagsControlClose(FlagsControl *control) {
+  if (control->Fd >= 0) {
+    close(control->Fd);
+    control->Fd = -1;
+  }
+
+  if (control->Path) {
+    unlink(control->Path);
+    free(control->Path);
+    control->Path = NULL;
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef FLAGS_CELL_H_
+#define FLAGS_CELL_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+// Cells are option values that may be updated while other threads read
+// them. Scalars are plain atomics read with a relaxed load. Strings are
+// guarded by a sequence lock: writers make Seq odd while copying and
+// readers retry until they observe the same even Seq before and after.
+typedef struct FlagCellString {
+  atomic_uint Seq;
+  size_t Cap;
+  size_t Len;
+  char *Value;
+} FlagCellString;
+
+#define FlagCellStringDeclare(name, cap)                                       \
+  char __##name[cap] = "";                                                     \
+  FlagCellString name = {.Seq = 0, .Cap = cap, .Len = 0, .Value = __##name}
+
+FlagOption FlagsNewAtomicBool(atomic_bool *value, const char *name,
+                              const char *help);
+FlagOption FlagsNewAtomicInt32(_Atomic int32_t *value, const char *name,
+                               const char *help);
+FlagOption FlagsNewAtomicInt64(_Atomic int64_t *value, const char *name,
+                               const char *help);
+FlagOption FlagsNewAtomicUint32(_Atomic uint32_t *value, const char *name,
+                                const char *help);
+FlagOption FlagsNewAtomicUint64(_Atomic uint64_t *value, const char *name,
+                                const char *help);
+FlagOption FlagsNewAtomicString(FlagCellString *value, const char *name,
+                                const char *help);
+
+static inline bool FlagCellLoadBool(atomic_bool *cell) {
+  return atomic_load_explicit(cell, memory_order_relaxed);
+}
+
+static inline int32_t FlagCellLoadInt32(_Atomic int32_t *cell) {
+  return atomic_load_explicit(cell, memory_order_relaxed);
+}
+
+static inline int64_t FlagCellLoadInt64(_Atomic int64_t *cell) {
+  return atomic_load_explicit(cell, memory_order_relaxed);
+}
+
+static inline uint32_t FlagCellLoadUint32(_Atomic uint32_t *cell) {
+  return atomic_load_explicit(cell, memory_order_relaxed);
+}
+
+static inline uint64_t FlagCellLoadUint64(_Atomic uint64_t *cell) {
+  return atomic_load_explicit(cell, memory_order_relaxed);
+}
+
+// FlagCellLoadString copies the string into out, truncating it to cap - 1
+// bytes, and returns its full length. Nothing is copied and 0 is returned
+// when cap is 0. FlagsNewAtomicString aborts on a cell without capacity.
+size_t FlagCellLoadString(FlagCellString *cell, char *out, size_t cap);
+bool FlagCellStoreString(FlagCellString *cell, const char *s, size_t len);
+
+bool ParseFuncAtomicBool(void *value, size_t maxLen, const char *s,
+                         size_t len);
+
+bool ParseFuncAtomicInt32(void *value, size_t maxLen, const char *s,
+                          size_t len);
+
+bool ParseFuncAtomicInt64(void *value, size_t maxLen, const char *s,
+                          size_t len);
+
+bool ParseFuncAtomicUint32(void *value, size_t maxLen, const char *s,
+                           size_t len);
+
+bool ParseFuncAtomicUint64(void *value, size_t maxLen, const char *s,
+                           size_t len);
+
+bool ParseFuncAtomicString(void *value, size_t maxLen, const char *s,
+                           size_t len);
+
+// FlagsControl applies name=value updates to the cells of Flags, received
+// one per line over a Unix domain socket. Every applied update bumps
+// Generation so that readers can cheaply detect that derived state must be
+// recomputed.
+typedef struct FlagsControl {
+  Flags *Flags;
+  int Fd;
+  char *Path;
+  atomic_uint_fast64_t Generation;
+} FlagsControl;
+
+FlagError FlagsControlOpen(FlagsControl *control, Flags *flags,
+                           const char *path);
+
+// FlagsControlApply validates and applies a single name=value update.
+FlagError FlagsControlApply(FlagsControl *control, const char *line,
+                            size_t len);
+
+// FlagsControlServe waits up to timeoutMs milliseconds for a connection and
+// applies every line it sends, answering each with "ok" or an error.
+FlagError FlagsControlServe(FlagsControl *control, int timeoutMs);
+void FlagsControlClose(FlagsControl *control);
+
+static inline uint64_t FlagsControlGeneration(FlagsControl *control) {
+  return atomic_load_explicit(&control->Generation, memory_order_acquire);
+}
+
+#endif // FLAGS_CELL_H_
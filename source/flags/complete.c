@@ -0,0 +1,349 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "complete.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "strings.h"
+
+// CompleteWriter batches candidates into few writes to fd. The first
+// failed write is kept in Err and stops further output.
+typedef struct CompleteWriter {
+  int Fd;
+  FlagError Err;
+  size_t Len;
+  char Buf[4096];
+} CompleteWriter;
+
+static void CompleteFlush(CompleteWriter *writer) {
+  if (!writer->Err) {
+    writer->Err = FlagsWriteAll(writer->Fd, writer->Buf, writer->Len);
+  }
+  writer->Len = 0;
+}
+
+static void CompleteAppend(CompleteWriter *writer, const char *s,
+                           size_t len) {
+  while (len > 0 && !writer->Err) {
+    if (writer->Len == sizeof(writer->Buf)) {
+      CompleteFlush(writer);
+    }
+
+    const size_t room = sizeof(writer->Buf) - writer->Len;
+    const size_t n = len < room ? len : room;
+    memcpy(writer->Buf + writer->Len, s, n);
+    writer->Len += n;
+    s += n;
+    len -= n;
+  }
+}
+
+static void CompleteEmit(CompleteWriter *writer, const char *prefix,
+                         size_t prefixLen, const char *name, size_t nameLen,
+                         const char *help) {
+  CompleteAppend(writer, prefix, prefixLen);
+  CompleteAppend(writer, name, nameLen);
+  CompleteAppend(writer, "\t", 1);
+  if (help) {
+    CompleteAppend(writer, help, strlen(help));
+  }
+  CompleteAppend(writer, "\n", 1);
+}
+
+static void CompleteRange(CompleteWriter *writer, const FlagPrefixIndex *index,
+                          const char *prefix, size_t prefixLen,
+                          const char *word, size_t len) {
+  size_t first;
+  size_t last;
+  FlagPrefixIndexRange(index, word, len, &first, &last);
+  for (size_t i = first; i < last; i++) {
+    const FlagPrefixEntry *entry = &index->Entries[i];
+    CompleteEmit(writer, prefix, prefixLen, entry->Name, entry->NameLen,
+                 entry->Help);
+  }
+}
+
+static bool CompileHelpItems(FlagPrefixIndex *index, const HelpItem *items,
+                             size_t stride, size_t len) {
+  if (FlagPrefixIndexIsCompiled(index)) {
+    return true;
+  }
+
+  if (!FlagPrefixIndexInit(index, len)) {
+    return false;
+  }
+
+  const char *ptr = (const char *)items;
+  for (size_t i = 0; i < len; i++, ptr += stride) {
+    const HelpItem *item = (const HelpItem *)ptr;
+    FlagPrefixIndexAdd(index, item->Name, strlen(item->Name), item->Help);
+  }
+  FlagPrefixIndexSort(index);
+  return true;
+}
+
+FlagError FlagsCompileCompletion(Flags *flags) {
+  FlagOptions *options = &flags->Options;
+  FlagCommands *cmds = &flags->Commands;
+  if (!CompileHelpItems(&options->Prefixes,
+                        options->OptionsLen ? &options->Options[0].Help : NULL,
+                        sizeof(FlagOption), options->OptionsLen) ||
+      !CompileHelpItems(&cmds->Prefixes,
+                        cmds->CommandsLen ? &cmds->Commands[0].Help : NULL,
+                        sizeof(FlagCommand), cmds->CommandsLen)) {
+    return FlagErrNoMemory;
+  }
+  return Ok;
+}
+
+static FlagError CompileNodeCompletion(FlagNode *node) {
+  const FlagNodes *children = &node->Children;
+  if (!CompileHelpItems(&node->ChildPrefixes,
+                        children->Len ? &children->Nodes[0].Help : NULL,
+                        sizeof(FlagNode), children->Len)) {
+    return FlagErrNoMemory;
+  }
+  return FlagsCompileCompletion(&node->Flags);
+}
+
+// CompleteValueOption returns the option named by word when it still
+// expects its value in the next word.
+static const FlagOption *CompleteValueOption(const Flags *flags,
+                                             const char *word) {
+  if (word[0] != '-' || word[1] == '\0') {
+    return NULL;
+  }
+
+  const char *name = word[1] == '-' ? word + 2 : word + 1;
+  if (strchr(name, '=')) {
+    return NULL;
+  }
+
+  const FlagOption *option = FlagsLookupOption(flags, name, strlen(name));
+  return option && option->NumArgs == 1 ? option : NULL;
+}
+
+static void CompleteChoices(CompleteWriter *writer, const FlagOption *option,
+                            const char *prefix, size_t prefixLen,
+                            const char *word) {
+  if (option->Type != FlagEnum) {
+    return;
+  }
+
+  const size_t len = strlen(word);
+  for (size_t i = 0; option->Choices[i]; i++) {
+    const char *choice = option->Choices[i];
+    const size_t choiceLen = strlen(choice);
+    // choices are parsed regardless of case, so they complete the same way
+    if (choiceLen >= len && StringFoldEqualsWithLen(choice, len, word, len)) {
+      CompleteEmit(writer, prefix, prefixLen, choice, choiceLen, NULL);
+    }
+  }
+}
+
+// CompleteWord writes the candidates for word given the word before it,
+// against the options of flags and the commands in commands.
+static void CompleteWord(CompleteWriter *writer, const Flags *flags,
+                         const FlagPrefixIndex *commands, const char *prev,
+                         const char *word) {
+  const FlagOption *option = prev ? CompleteValueOption(flags, prev) : NULL;
+  if (option) {
+    CompleteChoices(writer, option, "", 0, word);
+    return;
+  }
+
+  const size_t len = strlen(word);
+  if (word[0] == '-') {
+    const size_t dashes = word[1] == '-' ? 2 : 1;
+    const char *name = word + dashes;
+    const char *eq = StringFindChar(name, len - dashes, '=');
+    if (eq == word + len) {
+      CompleteRange(writer, &flags->Options.Prefixes, word, dashes, name,
+                    len - dashes);
+      return;
+    }
+
+    option = FlagsLookupOption(flags, name, (size_t)(eq - name));
+    if (option) {
+      CompleteChoices(writer, option, word, (size_t)(eq + 1 - word), eq + 1);
+    }
+
+  } else if (word[0] != '@') {
+    if (len == 0 && commands->Len == 0) {
+      CompleteRange(writer, &flags->Options.Prefixes, "-", 1, "", 0);
+      return;
+    }
+    CompleteRange(writer, commands, "", 0, word, len);
+  }
+}
+
+// CompletePrev returns the word before cursor that may take the completed
+// word as its value. Shells that split --name=value hand the = over as a
+// word of its own, which is skipped.
+static const char *CompletePrev(char *argv[], int cursor) {
+  if (cursor >= 3 && strcmp(argv[cursor - 1], "=") == 0) {
+    return argv[cursor - 2];
+  }
+  return cursor >= 2 ? argv[cursor - 1] : NULL;
+}
+
+static bool CompleteArgsValid(int argc, char *argv[], int cursor) {
+  if (cursor < 1 || cursor > argc) {
+    return false;
+  }
+
+  // nothing after -- is an option or command
+  for (int i = 1; i < cursor; i++) {
+    if (strcmp(argv[i], "--") == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+FlagError FlagsComplete(Flags *flags, int argc, char *argv[], int cursor,
+                        int fd) {
+  if (!CompleteArgsValid(argc, argv, cursor)) {
+    return Ok;
+  }
+
+  FlagError err = FlagsCompileCompletion(flags);
+  if (err) {
+    return err;
+  }
+
+  CompleteWriter writer = {.Fd = fd, .Err = Ok, .Len = 0};
+  const char *word = cursor < argc ? argv[cursor] : "";
+  CompleteWord(&writer, flags, &flags->Commands.Prefixes,
+               CompletePrev(argv, cursor), word);
+  CompleteFlush(&writer);
+  return writer.Err;
+}
+
+FlagError FlagsTreeComplete(FlagNode *root, int argc, char *argv[], int cursor,
+                            int fd) {
+  if (!CompleteArgsValid(argc, argv, cursor)) {
+    return Ok;
+  }
+
+  FlagNode *node = root;
+  for (int i = 1; i < cursor; i++) {
+    const char *arg = argv[i];
+    if (arg[0] == '-') {
+      // the value of an option is skipped with it
+      if (CompleteValueOption(&node->Flags, arg) && i + 1 < cursor) {
+        i++;
+      }
+      continue;
+    }
+
+    FlagNode *child = FlagsLookupNode(node, arg, strlen(arg));
+    if (child) {
+      node = child;
+    }
+  }
+
+  FlagError err = CompileNodeCompletion(node);
+  if (err) {
+    return err;
+  }
+
+  CompleteWriter writer = {.Fd = fd, .Err = Ok, .Len = 0};
+  const char *word = cursor < argc ? argv[cursor] : "";
+  CompleteWord(&writer, &node->Flags, &node->ChildPrefixes,
+               CompletePrev(argv, cursor), word);
+  CompleteFlush(&writer);
+  return writer.Err;
+}
+
+// CompleteRequest parses the cursor of a completion request in argv.
+static bool CompleteRequest(int argc, char *argv[], int *cursor) {
+  if (argc < 3 || strcmp(argv[1], FlagsCompleteCommand) != 0) {
+    return false;
+  }
+
+  int32_t value = 0;
+  if (!ParseInt32(&value, argv[2], strlen(argv[2]))) {
+    value = -1;
+  }
+  *cursor = value;
+  return true;
+}
+
+bool FlagsHandleComplete(Flags *flags, int argc, char *argv[]) {
+  int cursor;
+  if (!CompleteRequest(argc, argv, &cursor)) {
+    return false;
+  }
+
+  FlagsComplete(flags, argc - 3, argv + 3, cursor, STDOUT_FILENO);
+  return true;
+}
+
+bool FlagsTreeHandleComplete(FlagNode *root, int argc, char *argv[]) {
+  int cursor;
+  if (!CompleteRequest(argc, argv, &cursor)) {
+    return false;
+  }
+
+  FlagsTreeComplete(root, argc - 3, argv + 3, cursor, STDOUT_FILENO);
+  return true;
+}
+
+// The scripts are templates where %a stands for the program and %f for the
+// name of the completion function.
+static const char *const CompleteBash =
+    "# bash completion for %a\n"
+    "%f() {\n"
+    "  local IFS=$'\\n'\n"
+    "  local lines\n"
+    "  lines=($(\"${COMP_WORDS[0]}\" __complete \"$COMP_CWORD\" "
+    "\"${COMP_WORDS[@]}\" 2>/dev/null))\n"
+    "  COMPREPLY=(\"${lines[@]%%$'\\t'*}\")\n"
+    "}\n"
+    "complete -o default -F %f %a\n";
+
+static const char *const CompleteZsh =
+    "#compdef %a\n"
+    "%f() {\n"
+    "  local -a lines candidates\n"
+    "  local line\n"
+    "  lines=(\"${(@f)$(\"${words[1]}\" __complete \"$((CURRENT - 1))\" "
+    "\"${words[@]}\" 2>/dev/null)}\")\n"
+    "  for line in $lines; do\n"
+    "    candidates+=(\"${${line%%$'\\t'*}//:/\\\\:}:${line#*$'\\t'}\")\n"
+    "  done\n"
+    "  _describe -t values '%a' candidates\n"
+    "}\n"
+    "compdef %f %a\n";
+
+static void CompleteFunctionName(CompleteWriter *writer, const char *app) {
+  CompleteAppend(writer, "_", 1);
+  for (const char *c = app; *c; c++) {
+    const bool word = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                      (*c >= '0' && *c <= '9');
+    CompleteAppend(writer, word ? c : "_", 1);
+  }
+  CompleteAppend(writer, "_complete", 9);
+}
+
+FlagError FlagsWriteCompletion(int fd, const char *app, FlagsShell shell) {
+  const char *tmpl = shell == FlagsShellZsh ? CompleteZsh : CompleteBash;
+  CompleteWriter writer = {.Fd = fd, .Err = Ok, .Len = 0};
+  for (const char *c = tmpl; *c; c++) {
+    if (c[0] == '%' && c[1] == 'a') {
+      CompleteAppend(&writer, app, strlen(app));
+      c++;
+    } else if (c[0] == '%' && c[1] == 'f') {
+      CompleteFunctionName(&writer, app);
+      c++;
+    } else {
+      CompleteAppend(&writer, c, 1);
+    }
+  }
+  CompleteFlush(&writer);
+  return writer.Err;
+}
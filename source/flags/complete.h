@@ -0,0 +1,48 @@
+#ifndef FLAGS_COMPLETE_H_
+#define FLAGS_COMPLETE_H_
+
+#include <stdbool.h>
+
+#include "flags.h"
+#include "tree.h"
+
+// FlagsCompleteCommand is the hidden first argument that asks a program for
+// completions, as in app __complete cursor word...
+#define FlagsCompleteCommand "__complete"
+
+typedef enum FlagsShell {
+  FlagsShellBash,
+  FlagsShellZsh,
+} FlagsShell;
+
+// FlagsCompileCompletion sorts the names of the options and commands of
+// flags into prefix indexes. It is called by FlagsComplete when needed and
+// the indexes are released with FlagsRelease.
+FlagError FlagsCompileCompletion(Flags *flags);
+
+// FlagsComplete writes to fd the candidates for argv[cursor], the word
+// being completed, one per line as the candidate, a tab and its help text.
+// argv holds the words of the command line starting with the program and
+// cursor may be argc when a new word is started. Options are completed
+// after a dash, enum values after an option that takes one, and commands
+// otherwise.
+FlagError FlagsComplete(Flags *flags, int argc, char *argv[], int cursor,
+                        int fd);
+
+// FlagsTreeComplete is FlagsComplete for command trees. It follows the
+// commands given before cursor and completes the options and children of
+// the command reached.
+FlagError FlagsTreeComplete(FlagNode *root, int argc, char *argv[], int cursor,
+                            int fd);
+
+// FlagsHandleComplete answers a completion request, as sent by the scripts
+// of FlagsWriteCompletion, on standard output. It returns false when argv
+// is not a request, and the program should then parse it as usual.
+bool FlagsHandleComplete(Flags *flags, int argc, char *argv[]);
+bool FlagsTreeHandleComplete(FlagNode *root, int argc, char *argv[]);
+
+// FlagsWriteCompletion writes to fd a completion script for the program app
+// that calls app __complete on every tab.
+FlagError FlagsWriteCompletion(int fd, const char *app, FlagsShell shell);
+
+#endif // FLAGS_COMPLETE_H_
@@ -0,0 +1,154 @@
+#include "env.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "strings.h"
+
+typedef struct FlagEnvSlot {
+  uint64_t Hash;
+  FlagOption *Option;
+} FlagEnvSlot;
+
+typedef struct FlagEnvTable {
+  size_t Cap;
+  FlagEnvSlot *Slots;
+  const char *Prefix;
+  size_t PrefixLen;
+} FlagEnvTable;
+
+static char FlagEnvFold(char c) {
+  if (c >= 'a' && c <= 'z') {
+    return (char)(c - 'a' + 'A');
+  }
+  return c == '-' || c == '.' ? '_' : c;
+}
+
+static uint64_t FlagEnvHash(const FlagEnvTable *table,
+                            const FlagOption *option) {
+  if (option->EnvName) {
+    return StringHash(option->EnvName, strlen(option->EnvName));
+  }
+
+  uint64_t hash = StringHashAppend(StringHashOffset, table->Prefix,
+                                   table->PrefixLen);
+  for (const char *c = option->Help.Name; *c != '\0'; c++) {
+    const char folded = FlagEnvFold(*c);
+    hash = StringHashAppend(hash, &folded, 1);
+  }
+  return hash;
+}
+
+static bool FlagEnvMatches(const FlagEnvTable *table, const FlagOption *option,
+                           const char *key, size_t keyLen) {
+  if (option->EnvName) {
+    return StringEqualsWithLen(option->EnvName, strlen(option->EnvName), key,
+                               keyLen);
+  }
+
+  if (keyLen < table->PrefixLen ||
+      memcmp(key, table->Prefix, table->PrefixLen) != 0) {
+    return false;
+  }
+
+  const char *name = option->Help.Name;
+  size_t i = table->PrefixLen;
+  while (i < keyLen && *name != '\0' && key[i] == FlagEnvFold(*name)) {
+    i++;
+    name++;
+  }
+  return i == keyLen && *name == '\0';
+}
+
+static void FlagEnvInsert(FlagEnvTable *table, FlagOption *option) {
+  const uint64_t hash = FlagEnvHash(table, option);
+  const size_t mask = table->Cap - 1;
+  size_t i = hash & mask;
+  while (table->Slots[i].Option != NULL) {
+    i = (i + 1) & mask;
+  }
+  table->Slots[i].Hash = hash;
+  table->Slots[i].Option = option;
+}
+
+static FlagOption *FlagEnvFind(const FlagEnvTable *table, const char *key,
+                               size_t keyLen) {
+  const uint64_t hash = StringHash(key, keyLen);
+  const size_t mask = table->Cap - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const FlagEnvSlot *slot = &table->Slots[i];
+    if (slot->Option == NULL) {
+      return NULL;
+    }
+
+    if (slot->Hash == hash &&
+        FlagEnvMatches(table, slot->Option, key, keyLen)) {
+      return slot->Option;
+    }
+  }
+}
+
+FlagOption FlagsBindEnv(FlagOption option, const char *envName) {
+  option.EnvBound = true;
+  option.EnvName = envName;
+  return option;
+}
+
+FlagError FlagsParseEnv(Flags *flags, const char *prefix, char **envp,
+                        int *index) {
+  FlagOptions *options = &flags->Options;
+  size_t bound = 0;
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    bound += options->Options[i].EnvBound;
+  }
+
+  if (bound == 0 || envp == NULL) {
+    return Ok;
+  }
+
+  FlagError err = FlagsBeginInput(flags);
+  if (err) {
+    return err;
+  }
+
+  FlagEnvTable table = {.Cap = 8,
+                        .Prefix = prefix ? prefix : "",
+                        .PrefixLen = prefix ? strlen(prefix) : 0};
+  while (table.Cap < bound * 2) {
+    table.Cap *= 2;
+  }
+  table.Slots = calloc(table.Cap, sizeof(FlagEnvSlot));
+  if (!table.Slots) {
+    return FlagErrNoMemory;
+  }
+
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    if (options->Options[i].EnvBound) {
+      FlagEnvInsert(&table, &options->Options[i]);
+    }
+  }
+
+  for (int i = 0; envp[i] != NULL && !err; i++) {
+    const char *entry = envp[i];
+    const char *eq = strchr(entry, '=');
+    if (!eq) {
+      continue;
+    }
+
+    FlagOption *option = FlagEnvFind(&table, entry, (size_t)(eq - entry));
+    if (option) {
+      *index = i;
+      bool apply = true;
+      err = FlagsSeeOption(flags, option, &apply);
+      if (!err && apply) {
+        err = FlagsAcceptOption(flags, option, eq + 1, strlen(eq + 1));
+      }
+      if (err) {
+        flags->ErrorOption = (int)(option - options->Options);
+      }
+    }
+  }
+
+  free(table.Slots);
+  return err;
+}
@@ -0,0 +1,24 @@
+#ifndef FLAGS_ENV_H_
+#define FLAGS_ENV_H_
+
+#include "flags.h"
+
+// FlagsBindEnv binds option to the environment variable envName. When
+// envName is NULL the name is derived from the option name by
+// FlagsParseEnv: the prefix followed by the name in upper case with '-'
+// and '.' replaced by '_', so that max-conns becomes APP_MAX_CONNS for the
+// prefix APP_.
+FlagOption FlagsBindEnv(FlagOption option, const char *envName);
+
+// FlagsParseEnv walks envp once and parses the value of every variable
+// bound to an option with the option's ParseFunc. When several options
+// are bound to the same variable the first one receives it. Call it before
+// FlagsParse so that command line values take precedence, which for list
+// options means replacing the values from the environment. The options it
+// sets count as given for the required options and rules FlagsParse
+// checks. On error index is set to the position of the offending variable
+// in envp.
+FlagError FlagsParseEnv(Flags *flags, const char *prefix, char **envp,
+                        int *index);
+
+#endif // FLAGS_ENV_H_
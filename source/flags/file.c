@@ -0,0 +1,334 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "strings.h"
+
+typedef struct FlagFileId {
+  dev_t Dev;
+  ino_t Ino;
+} FlagFileId;
+
+// FlagFileParser writes values either through Flags, honoring lazy
+// parsing, or into Record when parsing against a read only schema. Files
+// parsed into a record are copied rather than mapped, since the pages of a
+// private mapping still follow the file until they are written to. Seen
+// tracks the options given to a record.
+typedef struct FlagFileParser {
+  const Flags *Schema;
+  Flags *Flags;
+  const FlagsRecord *Record;
+  FlagsSeenSet *Seen;
+  FlagFile **Files;
+  bool Copy;
+  size_t Len;
+  FlagFileId Ids[FlagsMaxFileDepth];
+} FlagFileParser;
+
+static FlagError FlagsParseFileAt(const char *path, FlagFileParser *parser);
+
+static FlagError FlagsParseFileValue(FlagFileParser *parser,
+                                     FlagOption *option, const char *s,
+                                     size_t len) {
+  bool apply = true;
+  FlagError err =
+      parser->Flags
+          ? FlagsSeeOption(parser->Flags, option, &apply)
+          : FlagsSeenAdd(parser->Schema, parser->Seen, option, &apply);
+  if (err || !apply) {
+    return err;
+  }
+
+  if (parser->Flags) {
+    return FlagsAcceptOption(parser->Flags, option, s, len);
+  }
+  return FlagsApplyOptionTo(option, parser->Record, s, len);
+}
+
+// FlagFileTokens walks the arguments of one flags file. Err is set when a
+// quote is not closed.
+typedef struct FlagFileTokens {
+  FlagFileParser *Parser;
+  const char *Next;
+  const char *End;
+  FlagError Err;
+} FlagFileTokens;
+
+// FlagsFileNext reads the next argument into token, skipping comments
+// unless a value is expected, since a value may start with '#' as in
+// -color #fff.
+static bool FlagsFileNext(FlagFileTokens *tokens, bool value,
+                          const char **token, size_t *len, bool *quoted) {
+  const char *c = tokens->Next;
+  const char *end = tokens->End;
+  for (;;) {
+    c = StringSkipBlank(c, (size_t)(end - c));
+    if (c == end) {
+      tokens->Next = end;
+      return false;
+    }
+
+    if (*c != '#' || value) {
+      break;
+    }
+    c = StringSkipLine(c, (size_t)(end - c));
+  }
+
+  *quoted = *c == '"' || *c == '\'';
+  if (*quoted) {
+    const char *close = memchr(c + 1, *c, (size_t)(end - c - 1));
+    if (!close) {
+      tokens->Err = FlagErrParse;
+      tokens->Next = end;
+      return false;
+    }
+    *token = c + 1;
+    *len = (size_t)(close - *token);
+    tokens->Next = close + 1;
+    return true;
+  }
+
+  *token = c;
+  tokens->Next = StringSkipNonBlank(c, (size_t)(end - c));
+  *len = (size_t)(tokens->Next - c);
+  return true;
+}
+
+static FlagError FlagsFileApply(void *ctx, FlagOption *option, const char *s,
+                                size_t len) {
+  FlagFileTokens *tokens = ctx;
+  return FlagsParseFileValue(tokens->Parser, option, s, len);
+}
+
+static bool FlagsFileValue(void *ctx, const char **s, size_t *len) {
+  bool quoted;
+  return FlagsFileNext(ctx, true, s, len, &quoted);
+}
+
+static FlagError FlagsParseTokens(const char *c, size_t len,
+                                  FlagFileParser *parser) {
+  FlagFileTokens tokens = {
+      .Parser = parser, .Next = c, .End = c + len, .Err = Ok};
+  FlagArgReader reader = {
+      .Apply = FlagsFileApply, .Next = FlagsFileValue, .Ctx = &tokens};
+  const char *token = NULL;
+  size_t tokenLen = 0;
+  bool quoted = false;
+
+  while (FlagsFileNext(&tokens, false, &token, &tokenLen, &quoted)) {
+    FlagError err = Ok;
+    if (!quoted && token[0] == '@') {
+      char path[PATH_MAX];
+      if (tokenLen >= sizeof(path)) {
+        return FlagErrFile;
+      }
+      memcpy(path, token + 1, tokenLen - 1);
+      path[tokenLen - 1] = '\0';
+      err = FlagsParseFileAt(path, parser);
+
+    } else if (!quoted && token[0] == '-') {
+      // options follow the syntax of FlagsParse
+      const FlagArg arg = FlagsSplitArg(token, tokenLen);
+      FlagOption *option = FlagsLookupOptionStats(
+          parser->Schema, arg.Name, arg.NameLen,
+          parser->Flags ? parser->Flags->Stats : NULL);
+      err = FlagsApplyArg(parser->Schema, &arg, option, &reader);
+
+    } else {
+      err = FlagsApplyCommandTo(parser->Schema, parser->Record, token,
+                                tokenLen);
+    }
+
+    if (tokens.Err) {
+      return tokens.Err;
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  return tokens.Err;
+}
+
+static FlagError FlagsCopyFile(int fd, FlagFile *file) {
+  file->Data = malloc(file->Len);
+  if (!file->Data) {
+    return FlagErrNoMemory;
+  }
+
+  // the file may have been truncated since it was sized
+  size_t done = 0;
+  while (done < file->Len) {
+    const ssize_t n = read(fd, (char *)file->Data + done, file->Len - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      free(file->Data);
+      return FlagErrFile;
+    }
+    if (n == 0) {
+      break;
+    }
+    done += (size_t)n;
+  }
+  file->Len = done;
+  return Ok;
+}
+
+static FlagError FlagsMapFile(int fd, size_t len, bool copy, FlagFile **files,
+                              FlagFile **file) {
+  FlagFile *mapped = malloc(sizeof(FlagFile));
+  if (!mapped) {
+    return FlagErrNoMemory;
+  }
+
+  mapped->Data = NULL;
+  mapped->Len = len;
+  mapped->Copied = copy;
+  if (len > 0 && copy) {
+    FlagError err = FlagsCopyFile(fd, mapped);
+    if (err) {
+      free(mapped);
+      return err;
+    }
+  } else if (len > 0) {
+    mapped->Data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped->Data == MAP_FAILED) {
+      free(mapped);
+      return FlagErrFile;
+    }
+  }
+
+  mapped->Next = *files;
+  *files = mapped;
+  *file = mapped;
+  return Ok;
+}
+
+static FlagError FlagsParseFileAt(const char *path, FlagFileParser *parser) {
+  if (parser->Len == FlagsMaxFileDepth) {
+    return FlagErrFileDepth;
+  }
+
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return FlagErrFile;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return FlagErrFile;
+  }
+
+  for (size_t i = 0; i < parser->Len; i++) {
+    if (parser->Ids[i].Dev == st.st_dev && parser->Ids[i].Ino == st.st_ino) {
+      close(fd);
+      return FlagErrFileCycle;
+    }
+  }
+
+  FlagFile *file = NULL;
+  FlagError err = FlagsMapFile(fd, (size_t)st.st_size, parser->Copy,
+                               parser->Files, &file);
+  close(fd);
+  if (err) {
+    return err;
+  }
+
+  parser->Ids[parser->Len].Dev = st.st_dev;
+  parser->Ids[parser->Len].Ino = st.st_ino;
+  parser->Len++;
+  err = FlagsParseTokens(file->Data, file->Len, parser);
+  parser->Len--;
+  return err;
+}
+
+FlagError FlagsParseFile(const char *path, Flags *flags) {
+  FlagError err = FlagsBeginInput(flags);
+  return err ? err : FlagsParseFileArg(path, flags);
+}
+
+FlagError FlagsParseFileArg(const char *path, Flags *flags) {
+  FlagFileParser parser = {
+      .Schema = flags, .Flags = flags, .Files = &flags->Files, .Len = 0};
+  return FlagsParseFileAt(path, &parser);
+}
+
+FlagError FlagsParseFileBuffer(const char *data, size_t len, Flags *flags) {
+  FlagError err = FlagsBeginInput(flags);
+  if (err) {
+    return err;
+  }
+
+  FlagFileParser parser = {
+      .Schema = flags, .Flags = flags, .Files = &flags->Files, .Len = 0};
+  return FlagsParseTokens(data, len, &parser);
+}
+
+FlagError FlagsParseFileInto(const char *path, const Flags *flags,
+                             const FlagsRecord *record, FlagFile **files) {
+  FlagsSeenSet seen;
+  FlagError err = FlagsSeenInit(&seen, flags);
+  if (err) {
+    return err;
+  }
+
+  FlagFileParser parser = {.Schema = flags,
+                           .Record = record,
+                           .Seen = &seen,
+                           .Files = files,
+                           .Copy = true};
+  err = FlagsParseFileAt(path, &parser);
+  if (!err) {
+    int errorOption = -1;
+    err = FlagsSeenCheck(flags, &seen, &errorOption);
+  }
+
+  FlagsSeenRelease(&seen);
+  return err;
+}
+
+void FlagFilesRelease(Flags *flags) {
+  FlagFilesFree(flags->Files);
+  flags->Files = NULL;
+}
+
+void FlagFilesFree(FlagFile *file) {
+  while (file) {
+    FlagFile *next = file->Next;
+    if (file->Copied) {
+      free(file->Data);
+    } else if (file->Data) {
+      munmap(file->Data, file->Len);
+    }
+    free(file);
+    file = next;
+  }
+}
+
+FlagError FlagsWriteAll(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    const ssize_t n = write(fd, buf, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return FlagErrFile;
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+  return Ok;
+}
@@ -0,0 +1,48 @@
+#ifndef FLAGS_FILE_H_
+#define FLAGS_FILE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "flags.h"
+
+#define FlagsMaxFileDepth 8
+
+// FlagFile keeps a flags file mapped, or copied when Copied is set, for as
+// long as the Flags that parsed it, since string views parsed from the file
+// borrow its contents.
+typedef struct FlagFile {
+  struct FlagFile *Next;
+  void *Data;
+  size_t Len;
+  bool Copied;
+} FlagFile;
+
+// FlagsParseFile maps the file at path and parses it as a sequence of
+// blank separated arguments, with options following the syntax of
+// FlagsParse. An argument starting with '#' where no value is expected
+// comments out the rest of its line. Values may be enclosed in single or
+// double quotes to include blanks, and @path includes another flags file,
+// up to FlagsMaxFileDepth levels deep.
+//
+// Each call is an input of the parse session of flags, which FlagsParse
+// checks, see FlagsBeginInput. FlagsParseFileArg parses the file named by
+// an @path argument as part of the current input instead.
+FlagError FlagsParseFile(const char *path, Flags *flags);
+FlagError FlagsParseFileArg(const char *path, Flags *flags);
+FlagError FlagsParseFileBuffer(const char *data, size_t len, Flags *flags);
+
+// FlagsParseFileInto parses the file at path into record without modifying
+// flags, adding copies of the files it reads to the files list, so that
+// string views in record do not change when the files are rewritten. It
+// checks the required options and rules of flags once the file is parsed.
+FlagError FlagsParseFileInto(const char *path, const Flags *flags,
+                             const FlagsRecord *record, FlagFile **files);
+void FlagFilesRelease(Flags *flags);
+void FlagFilesFree(FlagFile *files);
+
+// FlagsWriteAll writes len bytes of buf to fd, retrying writes that were
+// interrupted or only partly done, and returns FlagErrFile on failure.
+FlagError FlagsWriteAll(int fd, const char *buf, size_t len);
+
+#endif // FLAGS_FILE_H_
@@ -1,66 +1,452 @@
 #include "flags.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "cell.h"
+#include "file.h"
+#include "stats.h"
+#include "suggest.h"
 #include "strings.h"
 
-const int TabCharLen = 8;
+static bool FlagIsLazy(const FlagOption *option) {
+  if (option->NumArgs != 1) {
+    return false;
+  }
+
+  switch (option->Type) {
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList:
+    return false;
+  case FlagAtomicBool:
+  case FlagAtomicInt32:
+  case FlagAtomicInt64:
+  case FlagAtomicUint32:
+  case FlagAtomicUint64:
+  case FlagAtomicString:
+    // cells may be written at runtime, so a deferred value could overwrite
+    // a newer one when it is finally resolved
+    return false;
+  default:
+    return true;
+  }
+}
+
+FlagError FlagsAcceptOption(Flags *flags, FlagOption *option, const char *s,
+                            size_t len) {
+  if (flags->Lazy && FlagIsLazy(option)) {
+    option->Raw.Ptr = s;
+    option->Raw.Len = len;
+    option->Pending = true;
+    return Ok;
+  }
+
+  option->Pending = false;
+  FlagError err = FlagsApplyOption(option, s, len);
+  if (!err &&
+      (option->Type == FlagString || option->Type == FlagAtomicString)) {
+    // strings that do not fit are rejected rather than truncated
+    FlagsStatsAdd(flags->Stats, BytesCopied, len);
+  }
+  return err;
+}
+
+// FlagAccept applies a value given for option unless its duplicates policy
+// keeps an earlier one, and records the option an error refers to.
+static FlagError FlagAccept(Flags *flags, FlagOption *option, const char *s,
+                            size_t len) {
+  bool apply = true;
+  FlagError err = FlagsSeeOption(flags, option, &apply);
+  if (!err && apply) {
+    err = FlagsAcceptOption(flags, option, s, len);
+  }
+
+  if (err) {
+    flags->ErrorOption = (int)(option - flags->Options.Options);
+  }
+  return err;
+}
+
+FlagOption *FlagsLookupOption(const Flags *flags, const char *name,
+                              size_t len) {
+  return FlagsLookupOptionStats(flags, name, len, NULL);
+}
+
+FlagOption *FlagsLookupOptionStats(const Flags *flags, const char *name,
+                                   size_t len, struct FlagsStats *stats) {
+  const FlagOptions *options = &flags->Options;
+  if (FlagIndexIsCompiled(&options->Index)) {
+    size_t pos;
+    return FlagIndexFindStats(&options->Index, name, len, &pos, stats)
+               ? &options->Options[pos]
+               : NULL;
+  }
+
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    FlagOption *option = &options->Options[i];
+    const HelpItem *help = &option->Help;
+    FlagsStatsAdd(stats, Probes, 1);
+    if (len > 0 && help->Name[0] != name[0]) {
+      continue;
+    }
+
+    FlagsStatsAdd(stats, Compares, 1);
+    const size_t nameLen = help->NameLen ? help->NameLen : strlen(help->Name);
+    if (StringEqualsWithLen(name, len, help->Name, nameLen)) {
+      return option;
+    }
+  }
+
+  return NULL;
+}
+
+FlagOption *FlagsLookupShort(const Flags *flags, char c) {
+  const FlagOptions *options = &flags->Options;
+  const unsigned char u = (unsigned char)c;
+  if (u == 0 || u >= 128) {
+    return NULL;
+  }
+
+  if (options->Shorts) {
+    const uint32_t pos = options->Shorts[u];
+    return pos ? &options->Options[pos - 1] : NULL;
+  }
+
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    if (options->Options[i].Short == c) {
+      return &options->Options[i];
+    }
+  }
+
+  return NULL;
+}
+
+FlagOption FlagsShort(FlagOption option, char c) {
+  option.Short = c;
+  return option;
+}
+
+FlagCommand *FlagsLookupCommand(const Flags *flags, const char *name,
+                                size_t len) {
+  const FlagCommands *cmds = &flags->Commands;
+  if (FlagIndexIsCompiled(&cmds->Index)) {
+    size_t pos;
+    return FlagIndexFind(&cmds->Index, name, len, &pos) ? &cmds->Commands[pos]
+                                                         : NULL;
+  }
+
+  for (size_t i = 0; i < cmds->CommandsLen; i++) {
+    FlagCommand *cmd = &cmds->Commands[i];
+    if (StringEqualsWithLen(name, len, cmd->Help.Name,
+                            strlen(cmd->Help.Name))) {
+      return cmd;
+    }
+  }
+
+  return NULL;
+}
+
+void *FlagsRecordValue(const FlagsRecord *record, void *value) {
+  if (!record) {
+    return value;
+  }
+
+  const char *proto = record->Proto;
+  const char *ptr = value;
+  if (ptr < proto || ptr >= proto + record->Size) {
+    // every value must live in the prototype for records to be independent
+    abort();
+  }
+
+  return (char *)record->Base + (ptr - proto);
+}
+
+bool FlagsValueEquals(const FlagOption *option, const void *a,
+                      const void *b) {
+  switch (option->Type) {
+  case FlagBool:
+    return *(const bool *)a == *(const bool *)b;
+  case FlagEnum:
+    return *(const int *)a == *(const int *)b;
+  case FlagAtomicBool:
+    return atomic_load((const atomic_bool *)a) ==
+           atomic_load((const atomic_bool *)b);
+  case FlagString:
+    return strncmp(a, b, option->MaxLen) == 0;
+  case FlagStringView: {
+    const StringView *va = a;
+    const StringView *vb = b;
+    return va->Len == vb->Len &&
+           (va->Len == 0 || memcmp(va->Ptr, vb->Ptr, va->Len) == 0);
+  }
+  case FlagInt32:
+  case FlagUint32:
+  case FlagFloat:
+    // floating point values are compared bitwise so that NaN is unchanged
+    return memcmp(a, b, sizeof(uint32_t)) == 0;
+  case FlagInt64:
+  case FlagUint64:
+  case FlagDouble:
+  case FlagDuration:
+  case FlagByteSize:
+    return memcmp(a, b, sizeof(uint64_t)) == 0;
+  case FlagAtomicInt32:
+  case FlagAtomicUint32:
+    return atomic_load((const _Atomic uint32_t *)a) ==
+           atomic_load((const _Atomic uint32_t *)b);
+  case FlagAtomicInt64:
+  case FlagAtomicUint64:
+    return atomic_load((const _Atomic uint64_t *)a) ==
+           atomic_load((const _Atomic uint64_t *)b);
+  default:
+    // lists and string cells are compared by identity since their contents
+    // live elsewhere
+    return a == b;
+  }
+}
+
+FlagError FlagsApplyOption(FlagOption *option, const char *s, size_t len) {
+  return FlagsApplyOptionTo(option, NULL, s, len);
+}
+
+static bool FlagParseEnum(const FlagOption *option, int *value,
+                          const char *s, size_t len) {
+  size_t pos = 0;
+  if (FlagIndexIsCompiled(&option->ChoiceIndex)) {
+    if (!FlagIndexFind(&option->ChoiceIndex, s, len, &pos)) {
+      return false;
+    }
+
+    *value = (int)pos;
+    return true;
+  }
 
-static FlagError FlagParse(FlagOption *option, int argc, char **argv,
-                           int *cargc) {
+  for (; option->Choices[pos]; pos++) {
+    const char *choice = option->Choices[pos];
+    if (StringFoldEqualsWithLen(choice, strlen(choice), s, len)) {
+      *value = (int)pos;
+      return true;
+    }
+  }
+  return false;
+}
+
+// FlagsRecordStorage points storage, held by a value copied into record,
+// at the same bytes in record when it points into the prototype, so that
+// records do not share the elements of a list or the text of a cell. It
+// fails for storage outside the prototype, which every record would write.
+static bool FlagsRecordStorage(const FlagsRecord *record, void **storage,
+                               size_t size) {
+  const char *ptr = *storage;
+  const char *base = record->Base;
+  const char *proto = record->Proto;
+  if (size == 0 || (ptr >= base && ptr < base + record->Size)) {
+    return true;
+  }
+
+  if (ptr < proto || ptr >= proto + record->Size ||
+      size > (size_t)(proto + record->Size - ptr)) {
+    return false;
+  }
+
+  *storage = (char *)record->Base + (ptr - proto);
+  return true;
+}
+
+static bool FlagsRecordMove(const FlagOption *option,
+                            const FlagsRecord *record, void *value) {
+  switch (option->Type) {
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList: {
+    FlagList *list = value;
+    const size_t elem = option->Type == FlagInt64List    ? sizeof(int64_t)
+                        : option->Type == FlagUint32List ? sizeof(uint32_t)
+                                                         : sizeof(StringView);
+    return FlagsRecordStorage(record, &list->Values, list->Cap * elem);
+  }
+  case FlagAtomicString: {
+    FlagCellString *cell = value;
+    void *text = cell->Value;
+    if (!FlagsRecordStorage(record, &text, cell->Cap)) {
+      return false;
+    }
+    cell->Value = text;
+    return true;
+  }
+  default:
+    return true;
+  }
+}
+
+FlagError FlagsApplyOptionTo(const FlagOption *option,
+                             const FlagsRecord *record, const char *s,
+                             size_t len) {
+  void *value = FlagsRecordValue(record, option->Value);
+  if (record && !FlagsRecordMove(option, record, value)) {
+    return FlagErrType;
+  }
+  const bool ok = option->Type == FlagEnum
+                      ? FlagParseEnum(option, value, s, len)
+                      : option->ParseFunc(value, option->MaxLen, s, len);
+  return ok ? Ok : FlagErrParse;
+}
+
+FlagError FlagsApplyCommand(Flags *flags, const char *s, size_t len) {
+  return FlagsApplyCommandTo(flags, NULL, s, len);
+}
+
+FlagError FlagsApplyCommandTo(const Flags *flags, const FlagsRecord *record,
+                              const char *s, size_t len) {
+  if (!FlagsLookupCommand(flags, s, len)) {
+    return FlagErrUnknownCommand;
+  }
+
+  ParseFunc parse = flags->Commands.ParseFunc ? flags->Commands.ParseFunc
+                                              : &ParseFuncString;
+  void *value = FlagsRecordValue(record, flags->Commands.Value);
+  bool ok = parse(value, flags->Commands.MaxLen, s, len);
+  return ok ? Ok : FlagErrParse;
+}
+
+FlagArg FlagsSplitArg(const char *arg, size_t len) {
+  FlagArg split;
+  const size_t dashes = len > 1 && arg[1] == '-' ? 2 : 1;
+  split.Long = dashes == 2;
+  split.Name = arg + dashes;
+  split.RestLen = len - dashes;
+
+  const char *eq = StringFindChar(split.Name, split.RestLen, '=');
+  split.NameLen = (size_t)(eq - split.Name);
+  split.Value = split.NameLen < split.RestLen ? eq + 1 : NULL;
+  split.ValueLen = split.Value ? split.RestLen - split.NameLen - 1 : 0;
+  return split;
+}
+
+// FlagsApplyNext applies option, taking its value from the next argument
+// unless it does not need one.
+static FlagError FlagsApplyNext(FlagArgReader *reader, FlagOption *option) {
+  reader->Option = option;
   if (option->NumArgs == 0) {
-    if (option->Type != FlagBool) {
+    if (option->Type != FlagBool && option->Type != FlagAtomicBool) {
       abort();
     }
 
-    const bool ok = option->ParseFunc(option->Value, 0, "true", 4);
-    if (!ok) {
+    // a flag without a value always parses
+    return reader->Apply(reader->Ctx, option, "true", 4);
+  }
+
+  if (option->NumArgs != 1) {
+    abort();
+  }
+
+  const char *s = NULL;
+  size_t len = 0;
+  if (!reader->Next(reader->Ctx, &s, &len)) {
+    return FlagErrNoArg;
+  }
+  return reader->Apply(reader->Ctx, option, s, len);
+}
+
+FlagError FlagsApplyArg(const Flags *flags, const FlagArg *arg,
+                        FlagOption *option, FlagArgReader *reader) {
+  if (option && arg->Value) {
+    if (option->NumArgs > 1) {
       abort();
     }
 
-    return Ok;
+    reader->Option = option;
+    return reader->Apply(reader->Ctx, option, arg->Value, arg->ValueLen);
   }
 
-  if (option->NumArgs > argc) {
-    return FlagErrNoArg;
+  if (option) {
+    return FlagsApplyNext(reader, option);
   }
 
-  if (option->NumArgs != 1) {
-    abort();
+  if (arg->Long || arg->RestLen == 0) {
+    return FlagErrUnknownFlag;
   }
 
-  const bool ok = option->ParseFunc(option->Value, option->MaxLen, argv[0],
-                                    strlen(argv[0]));
-  if (!ok) {
-    return FlagErrParse;
+  // a cluster of short aliases such as -abc, where the last one may take a
+  // value attached as in -ofile
+  for (size_t i = 0; i < arg->RestLen; i++) {
+    option = FlagsLookupShort(flags, arg->Name[i]);
+    if (!option) {
+      return FlagErrUnknownFlag;
+    }
+
+    if (option->NumArgs > 0 && i + 1 < arg->RestLen) {
+      reader->Option = option;
+      return reader->Apply(reader->Ctx, option, arg->Name + i + 1,
+                           arg->RestLen - i - 1);
+    }
+
+    FlagError err = FlagsApplyNext(reader, option);
+    if (err || option->NumArgs > 0) {
+      return err;
+    }
   }
 
-  *cargc += option->NumArgs;
   return Ok;
 }
 
+// FlagArgv feeds FlagsApplyArg from argv, counting the arguments it takes
+// in cargc.
+typedef struct FlagArgv {
+  Flags *Flags;
+  int Argc;
+  char **Argv;
+  int *Cargc;
+} FlagArgv;
+
+static FlagError FlagArgvApply(void *ctx, FlagOption *option, const char *s,
+                               size_t len) {
+  FlagArgv *args = ctx;
+  return FlagAccept(args->Flags, option, s, len);
+}
+
+static bool FlagArgvNext(void *ctx, const char **s, size_t *len) {
+  FlagArgv *args = ctx;
+  if (*args->Cargc >= args->Argc) {
+    return false;
+  }
+
+  *s = args->Argv[*args->Cargc];
+  *len = strlen(*s);
+  *args->Cargc += 1;
+  return true;
+}
+
 FlagError FlagsParseNextFlag(int argc, char **argv, Flags *flags, int *cargc) {
   if (argv[0][0] != '-') {
     // only flags should be passed to this function
     abort();
   }
 
-  FlagOption *option = NULL;
-  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
-    if (StringEquals(argv[0] + 1, flags->Options.Options[i].Help.Name)) {
-      option = &flags->Options.Options[i];
-    }
-  }
+  // the token is measured once and only handled as spans from here on
+  FlagsStatsClock(start);
+  const FlagArg arg = FlagsSplitArg(argv[0], strlen(argv[0]));
+  FlagsStatsClock(split);
 
-  if (!option) {
-    return FlagErrUnknownFlag;
+  *cargc += 1;
+  FlagOption *option =
+      FlagsLookupOptionStats(flags, arg.Name, arg.NameLen, flags->Stats);
+  FlagsStatsClock(found);
+
+  FlagArgv args = {.Flags = flags, .Argc = argc, .Argv = argv, .Cargc = cargc};
+  FlagArgReader reader = {
+      .Apply = FlagArgvApply, .Next = FlagArgvNext, .Ctx = &args};
+  FlagError err = FlagsApplyArg(flags, &arg, option, &reader);
+  if (err == FlagErrNoArg && reader.Option) {
+    flags->ErrorOption = (int)(reader.Option - flags->Options.Options);
   }
 
-  *cargc += 1;
-  return FlagParse(option, argc - 1, argv + 1, cargc);
+  FlagsStatsObserve(flags->Stats, option, start, split, found);
+  return err;
 }
 
 FlagError FlagsParseCommand(int argc, char **argv, Flags *flags, int *cargc) {
@@ -70,26 +456,20 @@ FlagError FlagsParseCommand(int argc, char **argv, Flags *flags, int *cargc) {
     abort();
   }
 
-  FlagCommand *cmd = NULL;
-  for (size_t i = 0; i < flags->Commands.CommandsLen; i++) {
-    FlagCommand *cmdTmp = &flags->Commands.Commands[i];
-    if (StringEquals(argv[0], cmdTmp->Help.Name)) {
-      cmd = cmdTmp;
-    }
-  }
-
-  if (!cmd) {
-    return FlagErrUnknownCommand;
-  }
-
   *cargc += 0;
-  bool ok = ParseFuncString(flags->Commands.Value, flags->Commands.MaxLen,
-                            *argv, strlen(argv[0]));
-  if (!ok) {
-    return FlagErrParse;
+  return FlagsApplyCommand(flags, argv[0], strlen(argv[0]));
+}
+
+static FlagError FlagsParseResponseFile(int argc, char **argv, Flags *flags,
+                                        int *cargc) {
+  (void)argc;
+  if (argv[0][0] != '@') {
+    // only response files should be passed to this function
+    abort();
   }
 
-  return Ok;
+  *cargc += 1;
+  return FlagsParseFileArg(argv[0] + 1, flags);
 }
 
 FlagError FlagsParseNext(int argc, char **argv, Flags *flags, int *cargc) {
@@ -100,121 +480,194 @@ FlagError FlagsParseNext(int argc, char **argv, Flags *flags, int *cargc) {
   if (argv[0][0] == '-') {
     return FlagsParseNextFlag(argc, argv, flags, cargc);
 
+  } else if (argv[0][0] == '@') {
+    return FlagsParseResponseFile(argc, argv, flags, cargc);
+
   } else {
     return FlagsParseCommand(argc, argv, flags, cargc);
   }
 }
 
 FlagError FlagsParse(int argc, char *argv[], Flags *flags, int *index) {
-  FlagError err = Ok;
+  FlagError err = FlagsBeginInput(flags);
+  if (err) {
+    return err;
+  }
 
   for (int i = 1, cargc = i, nargc = argc - cargc;
        i < argc && !err && nargc > 0 && cargc > 0; i += cargc, nargc -= cargc) {
     char **nargv = argv + i;
     *index = i;
     cargc = 0;
+    if (nargv[0][0] == '-' && nargv[0][1] == '-' && nargv[0][2] == '\0') {
+      FlagsStatsAdd(flags->Stats, Tokens, 1);
+      *index = i + 1;
+      break;
+    }
     err = FlagsParseNext(nargc, nargv, flags, &cargc);
+    FlagsStatsAdd(flags->Stats, Tokens, (uint64_t)cargc);
   }
 
+  // the session ends here even on error, and the next input starts anew
+  if (!err) {
+    err = FlagsCheck(flags);
+  }
+  FlagsEndSession(flags);
   return err;
 }
 
-static const char *FlagErrorToString(FlagError err) {
-  switch (err) {
-  case Ok:
-    return "ok";
-  case FlagErrNoArg:
-    return "option expected argument";
-  case FlagErrParse:
-    return "failed to parse argument for option";
-  case FlagErrUnknownFlag:
-    return "unknown option provided";
-  case FlagErrMissingFlag:
-    return "option expected";
-  case FlagErrUnknownCommand:
-    return "unknown command provided";
-  default:
-    return "argument parser found unknown error";
+static FlagError FlagCompileChoices(FlagOption *option) {
+  if (option->Type != FlagEnum) {
+    return Ok;
   }
-}
 
-void FlagsPrintError(int argc, char *argv[], FlagError err, int index) {
-  if (err) {
-    fprintf(stderr, "%s: error: %s", argv[0], FlagErrorToString(err));
-    if (index >= 0 && index < argc) {
-      fprintf(stderr, " `%s`", argv[index]);
-    }
-    fprintf(stderr, "\n");
+  size_t len = 0;
+  while (option->Choices[len]) {
+    len++;
   }
-}
 
-size_t ComputeTabsTaken(size_t len) { return (len / TabCharLen) + 1; }
+  if (!FlagIndexInitFolded(&option->ChoiceIndex, len)) {
+    return FlagErrNoMemory;
+  }
 
-void PrintHelpItems(HelpItem *items, size_t len, const char *prefix) {
-  size_t maxLen = 0;
   for (size_t i = 0; i < len; i++) {
-    const HelpItem *item = &items[i];
-    const size_t itemLen = strlen(item->Name);
-    const size_t totalLen = TabCharLen + 1 + itemLen;
-    if (totalLen > maxLen) {
-      maxLen = totalLen;
+    const char *choice = option->Choices[i];
+    if (!FlagIndexInsert(&option->ChoiceIndex, choice, strlen(choice), i)) {
+      return FlagErrDuplicateName;
     }
   }
+  return Ok;
+}
 
-  size_t maxTabsTaken = ComputeTabsTaken(maxLen);
-  char tabsString[4];
-  for (size_t i = 0; i < len; i++) {
-    memset(tabsString, 0, 4); // NOLINT
+FlagError FlagsCompile(Flags *flags) {
+  FlagsRelease(flags);
 
-    const HelpItem *item = &items[i];
-    const size_t flagLen = strlen(item->Name);
-    const size_t totalLen = TabCharLen + 1 + flagLen;
-    const size_t tabsTaken = ComputeTabsTaken(totalLen);
-    size_t tabsAdded = maxTabsTaken - tabsTaken + 1;
+  FlagOptions *options = &flags->Options;
+  FlagCommands *cmds = &flags->Commands;
+  if (!FlagIndexInit(&options->Index, options->OptionsLen) ||
+      !FlagIndexInit(&cmds->Index, cmds->CommandsLen)) {
+    FlagsRelease(flags);
+    return FlagErrNoMemory;
+  }
 
-    if (tabsAdded > 4) {
-      tabsAdded = 4;
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    HelpItem *help = &options->Options[i].Help;
+    help->NameLen = strlen(help->Name);
+    if (!FlagIndexInsert(&options->Index, help->Name, help->NameLen, i)) {
+      FlagsRelease(flags);
+      return FlagErrDuplicateName;
     }
+  }
 
-    for (int j = 0; j < (int)tabsAdded; j++) {
-      tabsString[j] = '\t';
+  options->Shorts = calloc(128, sizeof(uint32_t));
+  if (!options->Shorts) {
+    FlagsRelease(flags);
+    return FlagErrNoMemory;
+  }
+
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    const unsigned char c = (unsigned char)options->Options[i].Short;
+    if (c == 0 || c >= 128) {
+      continue;
     }
 
-    fprintf(stderr, "%s%s%s%s\n", prefix, item->Name, tabsString, item->Help);
+    if (options->Shorts[c]) {
+      FlagsRelease(flags);
+      return FlagErrDuplicateName;
+    }
+    options->Shorts[c] = (uint32_t)i + 1;
   }
 
-  fprintf(stderr, "\n");
-}
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    FlagError err = FlagCompileChoices(&options->Options[i]);
+    if (err) {
+      FlagsRelease(flags);
+      return err;
+    }
+  }
 
-void FlagsPrintHelp(const char *app, Flags *flags) {
-  fprintf(stderr, "\n");
-  if (flags->Commands.CommandsLen > 0) {
-    fprintf(stderr, "USAGE:\t%s [OPTIONS] COMMAND\n", app);
+  for (size_t i = 0; i < cmds->CommandsLen; i++) {
+    HelpItem *help = &cmds->Commands[i].Help;
+    help->NameLen = strlen(help->Name);
+    if (!FlagIndexInsert(&cmds->Index, help->Name, help->NameLen, i)) {
+      FlagsRelease(flags);
+      return FlagErrDuplicateName;
+    }
+  }
 
-  } else {
-    fprintf(stderr, "USAGE:\t%s [OPTIONS]\n", app);
+  FlagError err = FlagsCompileRules(flags);
+  if (err) {
+    FlagsRelease(flags);
+    return err;
   }
-  fprintf(stderr, "\n");
 
-  if (flags->Options.OptionsLen > 0) {
-    fprintf(stderr, "OPTIONS:\n");
-    HelpItem flagsHelp[flags->Options.OptionsLen];
-    for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
-      flagsHelp[i] = flags->Options.Options[i].Help;
-    }
-    PrintHelpItems(flagsHelp, flags->Options.OptionsLen, "\t-");
+  return Ok;
+}
+
+void FlagsRelease(Flags *flags) {
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagIndexRelease(&flags->Options.Options[i].ChoiceIndex);
   }
 
-  if (flags->Commands.CommandsLen > 0) {
-    fprintf(stderr, "COMMANDS:\n");
-    HelpItem commandsHelp[flags->Commands.CommandsLen];
-    for (size_t i = 0; i < flags->Commands.CommandsLen; i++) {
-      commandsHelp[i] = flags->Commands.Commands[i].Help;
-    }
-    PrintHelpItems(commandsHelp, flags->Commands.CommandsLen, "\t");
+  free(flags->Options.Shorts);
+  flags->Options.Shorts = NULL;
+  FlagsReleaseRules(flags);
+  FlagIndexRelease(&flags->Options.Index);
+  FlagIndexRelease(&flags->Commands.Index);
+  FlagPrefixIndexRelease(&flags->Options.Prefixes);
+  FlagPrefixIndexRelease(&flags->Commands.Prefixes);
+  FlagFilesRelease(flags);
+}
+
+const char *FlagErrorToString(FlagError err) {
+  switch (err) {
+  case Ok:
+    return "ok";
+  case FlagErrNoArg:
+    return "option expected argument";
+  case FlagErrParse:
+    return "failed to parse argument for option";
+  case FlagErrUnknownFlag:
+    return "unknown option provided";
+  case FlagErrMissingFlag:
+    return "option expected";
+  case FlagErrUnknownCommand:
+    return "unknown command provided";
+  case FlagErrNoMemory:
+    return "failed to allocate memory";
+  case FlagErrDuplicateName:
+    return "option or command defined more than once";
+  case FlagErrFile:
+    return "failed to read flags file";
+  case FlagErrFileDepth:
+    return "flags files nested too deeply";
+  case FlagErrFileCycle:
+    return "flags file includes itself";
+  case FlagErrType:
+    return "option accessed with the wrong type";
+  case FlagErrControl:
+    return "control socket failed";
+  case FlagErrMissingCommand:
+    return "command expected";
+  case FlagErrSchema:
+    return "serialized flags do not match the options";
+  case FlagErrShared:
+    return "shared flags region failed";
+  case FlagErrDuplicateFlag:
+    return "option given more than once";
+  case FlagErrConflict:
+    return "options cannot be given together";
+  case FlagErrTreeDepth:
+    return "commands nested too deeply";
+  default:
+    return "argument parser found unknown error";
   }
 }
 
+void FlagsPrintError(int argc, char *argv[], FlagError err, int index) {
+  FlagsReportError(NULL, argc, argv, err, index);
+}
+
 FlagOption FlagsNewBool(bool *value, const char *name, const char *help) {
   FlagOption option = {.Type = FlagBool,
                        .NumArgs = 0,
@@ -236,6 +689,17 @@ FlagOption FlagsNewString(char *value, size_t maxLen, const char *name,
   return option;
 }
 
+FlagOption FlagsNewStringView(StringView *value, const char *name,
+                              const char *help) {
+  FlagOption option = {.Type = FlagStringView,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncStringView,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
 FlagOption FlagsNewInt32(int32_t *value, const char *name, const char *help) {
   FlagOption option = {.Type = FlagInt32,
                        .NumArgs = 1,
@@ -276,13 +740,101 @@ FlagOption FlagsNewUint64(uint64_t *value, const char *name, const char *help) {
   return option;
 }
 
+FlagOption FlagsNewFloat(float *value, const char *name, const char *help) {
+  FlagOption option = {.Type = FlagFloat,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncFloat,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewDouble(double *value, const char *name, const char *help) {
+  FlagOption option = {.Type = FlagDouble,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncDouble,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewDuration(int64_t *value, const char *name,
+                            const char *help) {
+  FlagOption option = {.Type = FlagDuration,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncDuration,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewByteSize(uint64_t *value, const char *name,
+                            const char *help) {
+  FlagOption option = {.Type = FlagByteSize,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncByteSize,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewEnum(int *value, const char *const *choices,
+                        const char *name, const char *help) {
+  FlagOption option = {.Type = FlagEnum,
+                       .NumArgs = 1,
+                       .ParseFunc = NULL,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = value,
+                       .MaxLen = 0,
+                       .Choices = choices};
+  return option;
+}
+
+FlagOption FlagsNewInt64List(FlagList *list, const char *name,
+                             const char *help) {
+  FlagOption option = {.Type = FlagInt64List,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncInt64List,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = list,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewUint32List(FlagList *list, const char *name,
+                              const char *help) {
+  FlagOption option = {.Type = FlagUint32List,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncUint32List,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = list,
+                       .MaxLen = 0};
+  return option;
+}
+
+FlagOption FlagsNewStringViewList(FlagList *list, const char *name,
+                                  const char *help) {
+  FlagOption option = {.Type = FlagStringViewList,
+                       .NumArgs = 1,
+                       .ParseFunc = &ParseFuncStringViewList,
+                       .Help = {.Name = name, .Help = help},
+                       .Value = list,
+                       .MaxLen = 0};
+  return option;
+}
+
 FlagCommand FlagNewCommand(const char *name, const char *help) {
   FlagCommand cmd = {.Help = {.Name = name, .Help = help}};
   return cmd;
 }
 
 Flags FlagsDefine(FlagOptions options, FlagCommands commands) {
-  Flags flags = {.Options = options, .Commands = commands};
+  Flags flags = {
+      .Options = options, .Commands = commands, .ErrorOption = -1};
   return flags;
 }
 
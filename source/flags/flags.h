@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "index.h"
 #include "parse.h"
 
 typedef int FlagError;
@@ -14,21 +15,62 @@ typedef int FlagError;
 #define FlagErrUnknownFlag 3
 #define FlagErrMissingFlag 4
 #define FlagErrUnknownCommand 5
+#define FlagErrNoMemory 6
+#define FlagErrDuplicateName 7
+#define FlagErrFile 8
+#define FlagErrFileDepth 9
+#define FlagErrFileCycle 10
+#define FlagErrType 11
+#define FlagErrControl 12
+#define FlagErrMissingCommand 13
+#define FlagErrSchema 14
+#define FlagErrShared 15
+#define FlagErrDuplicateFlag 16
+#define FlagErrConflict 17
+#define FlagErrTreeDepth 18
 
+// HelpItem describes an option or command on the help screen. NameLen is
+// filled in by FlagsCompile and Group is set with FlagsGroup.
 typedef struct HelpItem {
   const char *Name;
   const char *Help;
+  const char *Group;
+  size_t NameLen;
 } HelpItem;
 
 typedef enum FlagType {
   FlagBool,
   FlagString,
+  FlagStringView,
   FlagInt32,
   FlagInt64,
   FlagUint32,
   FlagUint64,
+  FlagInt64List,
+  FlagUint32List,
+  FlagStringViewList,
+  FlagAtomicBool,
+  FlagAtomicInt32,
+  FlagAtomicInt64,
+  FlagAtomicUint32,
+  FlagAtomicUint64,
+  FlagAtomicString,
+  FlagFloat,
+  FlagDouble,
+  FlagDuration,
+  FlagByteSize,
+  FlagEnum,
 } FlagType;
 
+// FlagDuplicates decides what happens when an option is given more than
+// once on the command line: every occurrence is applied, only the first
+// one is, or parsing fails with FlagErrDuplicateFlag.
+typedef enum FlagDuplicates {
+  FlagDuplicatesLastWins,
+  FlagDuplicatesFirstWins,
+  FlagDuplicatesError,
+} FlagDuplicates;
+
 typedef struct FlagOption {
   enum FlagType Type;
   int NumArgs;
@@ -36,36 +78,123 @@ typedef struct FlagOption {
   void *Value;
   size_t MaxLen;
   HelpItem Help;
+  bool EnvBound;
+  const char *EnvName;
+  bool Pending;
+  StringView Raw;
+  const char *const *Choices;
+  FlagIndex ChoiceIndex;
+  char Short;
+  bool Required;
+  FlagDuplicates Duplicates;
 } FlagOption;
 
+// FlagOptions Shorts maps each ASCII short alias to one plus the position of
+// its option, and is built by FlagsCompile. Seen has a bit per option
+// position set once the option is given in the parse session, followed by
+// as many words with the options given in the current input. It is kept in
+// SeenWords for up to 64 options and allocated otherwise. Masks holds the
+// bitmasks of the required options and of every rule once compiled.
+// Prefixes is built for completion by FlagsCompileCompletion.
 typedef struct FlagOptions {
   size_t OptionsLen;
   FlagOption *Options;
+  FlagIndex Index;
+  FlagPrefixIndex Prefixes;
+  uint32_t *Shorts;
+  uint64_t *Seen;
+  uint64_t SeenWords[2];
+  uint64_t *Masks;
 } FlagOptions;
 
+typedef enum FlagRuleKind {
+  FlagRuleConflict,
+  FlagRuleRequires,
+} FlagRuleKind;
+
+// FlagRule relates the options named in the NULL terminated Names. At most
+// one option of a conflict may be given, and when the first option of a
+// requires rule is given all the others must be given too.
+typedef struct FlagRule {
+  FlagRuleKind Kind;
+  const char *const *Names;
+} FlagRule;
+
+typedef struct FlagRules {
+  size_t RulesLen;
+  FlagRule *Rules;
+} FlagRules;
+
 typedef struct FlagCommand {
   HelpItem Help;
 } FlagCommand;
 
+// FlagCommands stores the selected command in Value through ParseFunc,
+// which copies it into a char buffer of MaxLen bytes by default.
 typedef struct FlagCommands {
-  char *Value;
+  void *Value;
+  ParseFunc ParseFunc;
   FlagCommand *Commands;
   size_t MaxLen;
   size_t CommandsLen;
+  FlagIndex Index;
+  FlagPrefixIndex Prefixes;
 } FlagCommands;
 
+struct FlagFile;
+struct FlagsStats;
+
+// Flags parsed with Lazy set only record the text of each single valued
+// option in Raw and leave its conversion to the first access through
+// FlagsResolve or the FlagsGet functions. Stats, when not NULL, is filled
+// by FlagsParse in builds with FLAGS_ENABLE_STATS. ErrorOption is set by
+// FlagsParse to the position of the option its error refers to, or -1.
+// Finished is set once FlagsParse or FlagsCheck ends a parse session, so
+// that the next input starts a new one.
 typedef struct Flags {
   FlagOptions Options;
   FlagCommands Commands;
+  FlagRules Rules;
+  struct FlagFile *Files;
+  struct FlagsStats *Stats;
+  bool Lazy;
+  bool Finished;
+  int ErrorOption;
 } Flags;
 
 FlagOption FlagsNewBool(bool *value, const char *name, const char *help);
 FlagOption FlagsNewString(char *value, size_t maxLen, const char *name,
                           const char *help);
+FlagOption FlagsNewStringView(StringView *value, const char *name,
+                              const char *help);
 FlagOption FlagsNewInt32(int32_t *value, const char *name, const char *help);
 FlagOption FlagsNewInt64(int64_t *value, const char *name, const char *help);
 FlagOption FlagsNewUint32(uint32_t *value, const char *name, const char *help);
 FlagOption FlagsNewUint64(uint64_t *value, const char *name, const char *help);
+FlagOption FlagsNewFloat(float *value, const char *name, const char *help);
+FlagOption FlagsNewDouble(double *value, const char *name, const char *help);
+
+// FlagsNewDuration stores a duration such as 1h30m in nanoseconds and
+// FlagsNewByteSize stores a size such as 64MiB in bytes.
+FlagOption FlagsNewDuration(int64_t *value, const char *name,
+                            const char *help);
+FlagOption FlagsNewByteSize(uint64_t *value, const char *name,
+                            const char *help);
+
+// FlagsNewEnum stores in value the position of the argument within the NULL
+// terminated choices, compared without regard to ASCII case. FlagsCompile
+// hashes the choices so that they are resolved in constant time.
+FlagOption FlagsNewEnum(int *value, const char *const *choices,
+                        const char *name, const char *help);
+
+// List options append one or more ',' separated values to a FlagList on
+// every occurrence, without allocating.
+FlagOption FlagsNewInt64List(FlagList *list, const char *name,
+                             const char *help);
+FlagOption FlagsNewUint32List(FlagList *list, const char *name,
+                              const char *help);
+FlagOption FlagsNewStringViewList(FlagList *list, const char *name,
+                                  const char *help);
 FlagCommand FlagNewCommand(const char *name, const char *help);
 
 #define FlagCommandsDeclare(var, output, outputLen, ...)                       \
@@ -74,22 +203,190 @@ FlagCommand FlagNewCommand(const char *name, const char *help);
       .CommandsLen = sizeof(__##var) / sizeof(FlagCommand),                    \
       .Commands = __##var,                                                     \
       .Value = output,                                                         \
+      .ParseFunc = &ParseFuncString,                                           \
       .MaxLen = outputLen,                                                     \
   }
 
+#define FlagCommandsDeclareView(var, output, ...)                              \
+  FlagCommand __##var[] = {__VA_ARGS__};                                       \
+  FlagCommands var = {                                                         \
+      .CommandsLen = sizeof(__##var) / sizeof(FlagCommand),                    \
+      .Commands = __##var,                                                     \
+      .Value = output,                                                         \
+      .ParseFunc = &ParseFuncStringView,                                       \
+      .MaxLen = 0,                                                             \
+  }
+
 #define FlagOptionsDeclare(var, ...)                                           \
   FlagOption __##var[] = {__VA_ARGS__};                                        \
   FlagOptions var = {                                                          \
       .OptionsLen = sizeof(__##var) / sizeof(FlagOption),                      \
-      .Options = __options,                                                    \
+      .Options = __##var,                                                      \
+  }
+
+#define FlagOptionsNone ((FlagOptions){.OptionsLen = 0, .Options = NULL})
+
+#define FlagRulesDeclare(var, ...)                                             \
+  FlagRule __##var[] = {__VA_ARGS__};                                          \
+  FlagRules var = {                                                            \
+      .RulesLen = sizeof(__##var) / sizeof(FlagRule),                          \
+      .Rules = __##var,                                                        \
   }
 
+FlagRule FlagNewConflict(const char *const *names);
+FlagRule FlagNewRequires(const char *const *names);
+
 Flags FlagsDefine(FlagOptions options, FlagCommands commands);
 Flags FlagsDefineOnlyOptions(FlagOptions options);
 Flags FlagsDefineOnlyCommands(FlagCommands cmds);
 
+// FlagsCompile builds the name lookup indexes for the options and commands
+// of flags so that FlagsParse resolves every token in constant time. Flags
+// that have not been compiled are resolved with a linear scan. The indexes
+// must be released with FlagsRelease.
+FlagError FlagsCompile(Flags *flags);
+void FlagsRelease(Flags *flags);
+
+// FlagsRecord redirects parsed values away from the storage the options were
+// defined against. Every option Value must point inside the Size bytes at
+// Proto, and is written at the same offset from Base instead. The elements
+// of lists and the text of string cells must live in Proto as well, and are
+// moved to Base the same way, or parsing them fails with FlagErrType.
+typedef struct FlagsRecord {
+  const void *Proto;
+  size_t Size;
+  void *Base;
+} FlagsRecord;
+
+// FlagsLookupOption finds the option called name. FlagsLookupOptionStats
+// also counts its probes in stats, which FlagsParse passes from Flags. The
+// paths parsing into records pass none, since they may run concurrently.
+FlagOption *FlagsLookupOption(const Flags *flags, const char *name,
+                              size_t len);
+FlagOption *FlagsLookupOptionStats(const Flags *flags, const char *name,
+                                   size_t len, struct FlagsStats *stats);
+FlagOption *FlagsLookupShort(const Flags *flags, char c);
+
+// FlagsRequired returns option marked as required, so that FlagsParse fails
+// with FlagErrMissingFlag when it is not given.
+FlagOption FlagsRequired(FlagOption option);
+
+// FlagsDuplicates returns option with the given policy for repeated
+// occurrences.
+FlagOption FlagsDuplicates(FlagOption option, FlagDuplicates policy);
+
+// A parse session gathers the options given by every input, such as
+// FlagsParseEnv, FlagsParseFile and FlagsParse, until FlagsParse or
+// FlagsCheck evaluates the required options and rules against them. The
+// duplicates policy applies within one input, so that a later input
+// overrides an earlier one. A list given by a later input is emptied
+// before its first value there, instead of appending to the earlier one.
+//
+// FlagsBeginInput starts an input, and a new session when the previous one
+// was finished. FlagsSeeOption records that option was given and sets
+// apply to whether its value should be applied, following the duplicates
+// policy of option. FlagsResetSeen forgets every option given so far and
+// clears ErrorOption. Values a lazy session left pending are resolved then,
+// so that they persist like those of an eager parse. FlagsCheck finishes the
+// session and sets ErrorOption on failure. FlagsEndSession finishes it
+// without a check, as FlagsParse does on error. Flags that were not compiled
+// only allocate the words tracking more than 64 options for one session,
+// so a session they begin must be finished by FlagsParse, FlagsCheck or
+// FlagsEndSession.
+FlagError FlagsBeginInput(Flags *flags);
+FlagError FlagsSeeOption(Flags *flags, const FlagOption *option, bool *apply);
+void FlagsResetSeen(Flags *flags);
+FlagError FlagsCheck(Flags *flags);
+void FlagsEndSession(Flags *flags);
+
+// FlagsSeenSet tracks the options given while parsing into a record, where
+// the shared Flags cannot, for FlagsSeenCheck to evaluate the required
+// options and rules against them.
+typedef struct FlagsSeenSet {
+  uint64_t *Words;
+  uint64_t Stack[4];
+} FlagsSeenSet;
+
+FlagError FlagsSeenInit(FlagsSeenSet *seen, const Flags *flags);
+void FlagsSeenRelease(FlagsSeenSet *seen);
+FlagError FlagsSeenAdd(const Flags *flags, FlagsSeenSet *seen,
+                       const FlagOption *option, bool *apply);
+FlagError FlagsSeenCheck(const Flags *flags, const FlagsSeenSet *seen,
+                         int *errorOption);
+
+// FlagsCompileRules allocates the seen bits and builds the masks that
+// FlagsCheck evaluates, for FlagsCompile. FlagsReleaseRules frees them.
+FlagError FlagsCompileRules(Flags *flags);
+void FlagsReleaseRules(Flags *flags);
+
+// FlagsShort returns option with the short alias c, so that it can be given
+// as -c and clustered with other short options as in -abc.
+FlagOption FlagsShort(FlagOption option, char c);
+FlagCommand *FlagsLookupCommand(const Flags *flags, const char *name,
+                                size_t len);
+void *FlagsRecordValue(const FlagsRecord *record, void *value);
+bool FlagsValueEquals(const FlagOption *option, const void *a,
+                      const void *b);
+FlagError FlagsAcceptOption(Flags *flags, FlagOption *option, const char *s,
+                            size_t len);
+FlagError FlagsApplyOption(FlagOption *option, const char *s, size_t len);
+FlagError FlagsApplyOptionTo(const FlagOption *option,
+                             const FlagsRecord *record, const char *s,
+                             size_t len);
+FlagError FlagsApplyCommand(Flags *flags, const char *s, size_t len);
+FlagError FlagsApplyCommandTo(const Flags *flags, const FlagsRecord *record,
+                              const char *s, size_t len);
+
+// FlagsParse parses the options and commands in argv. Options are given as
+// -name or --name, followed by their value either in the next argument or
+// after '=' as in --name=value. Short aliases can be clustered as in -abc,
+// where only the last one may take a value, either attached as in -ofile or
+// in the next argument. An argument of the form @path is replaced by the
+// contents of the flags file at path, see FlagsParseFile. The argument --
+// ends parsing and index is then set to the argument following it.
 FlagError FlagsParse(int argc, char *argv[], Flags *flags, int *index);
+
+// FlagArg splits an argument starting with '-'. Rest spans the RestLen
+// bytes after the dashes and Name its first NameLen bytes, up to any '='.
+// Value is what follows the '=', or NULL, and Long is set for two dashes.
+typedef struct FlagArg {
+  const char *Name;
+  size_t NameLen;
+  size_t RestLen;
+  const char *Value;
+  size_t ValueLen;
+  bool Long;
+} FlagArg;
+
+FlagArg FlagsSplitArg(const char *arg, size_t len);
+
+// FlagArgReader is where FlagsApplyArg sends values and takes the next
+// argument from when an option needs one, so that argv, flags files and
+// buffers share the syntax of FlagsParse. Option is set to the last option
+// handled, which an error refers to.
+typedef struct FlagArgReader {
+  FlagError (*Apply)(void *ctx, FlagOption *option, const char *s,
+                     size_t len);
+  bool (*Next)(void *ctx, const char **s, size_t *len);
+  void *Ctx;
+  FlagOption *Option;
+} FlagArgReader;
+
+// FlagsApplyArg applies the split argument arg, whose name was looked up as
+// option, or as a cluster of short aliases when option is NULL.
+FlagError FlagsApplyArg(const Flags *flags, const FlagArg *arg,
+                        FlagOption *option, FlagArgReader *reader);
+
+// FlagsParseNextFlag parses the option in argv[0] together with its value,
+// adding the number of arguments it consumed to cargc.
+FlagError FlagsParseNextFlag(int argc, char **argv, Flags *flags, int *cargc);
+
+const char *FlagErrorToString(FlagError err);
 void FlagsPrintError(int argc, char *argv[], FlagError error, int index);
+
+// FlagsPrintHelp writes the help screen of flags to stderr, see
+// FlagsWriteHelp.
 void FlagsPrintHelp(const char *app, Flags *flags);
+void PrintHelpItems(HelpItem *items, size_t len, const char *prefix);
 
 #endif // FLAGS_FLAGS_H_
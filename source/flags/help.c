@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "help.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file.h"
+
+const int TabCharLen = 8;
+
+size_t ComputeTabsTaken(size_t len) { return (len / TabCharLen) + 1; }
+
+// HelpWriter renders into Buf like snprintf, counting the bytes that did
+// not fit. A writer with Grow set moves to the heap and doubles Buf instead,
+// so that a screen is rendered once whatever its size, and sets Failed when
+// it runs out of memory.
+typedef struct HelpWriter {
+  char *Buf;
+  size_t Cap;
+  size_t Len;
+  bool Grow;
+  bool Heap;
+  bool Failed;
+} HelpWriter;
+
+static void HelpGrow(HelpWriter *writer, size_t need) {
+  size_t cap = writer->Cap * 2;
+  while (cap < need) {
+    cap *= 2;
+  }
+
+  char *buf = writer->Heap ? realloc(writer->Buf, cap) : malloc(cap);
+  if (!buf) {
+    writer->Failed = true;
+    return;
+  }
+
+  if (!writer->Heap) {
+    memcpy(buf, writer->Buf, writer->Len);
+  }
+  writer->Buf = buf;
+  writer->Cap = cap;
+  writer->Heap = true;
+}
+
+static void HelpAppend(HelpWriter *writer, const char *s, size_t len) {
+  if (writer->Grow && !writer->Failed && writer->Len + len >= writer->Cap) {
+    HelpGrow(writer, writer->Len + len + 1);
+  }
+
+  if (writer->Len + 1 < writer->Cap) {
+    const size_t room = writer->Cap - writer->Len - 1;
+    memcpy(writer->Buf + writer->Len, s, len < room ? len : room);
+  }
+  writer->Len += len;
+}
+
+static void HelpAppendString(HelpWriter *writer, const char *s) {
+  HelpAppend(writer, s, strlen(s));
+}
+
+static void HelpAppendTabs(HelpWriter *writer, size_t n) {
+  static const char tabs[] = "\t\t\t\t\t\t\t\t";
+  while (n > 0) {
+    const size_t chunk = n < sizeof(tabs) - 1 ? n : sizeof(tabs) - 1;
+    HelpAppend(writer, tabs, chunk);
+    n -= chunk;
+  }
+}
+
+static size_t HelpFinish(HelpWriter *writer) {
+  if (writer->Cap > 0) {
+    const size_t end =
+        writer->Len < writer->Cap ? writer->Len : writer->Cap - 1;
+    writer->Buf[end] = 0;
+  }
+  return writer->Len;
+}
+
+static size_t HelpNameLen(const HelpItem *item) {
+  // FlagsCompile caches the length of every name
+  return item->NameLen ? item->NameLen : strlen(item->Name);
+}
+
+static bool HelpSelected(const HelpItem *item, size_t nameLen,
+                         const FlagsHelpFilter *filter) {
+  if (!filter) {
+    return true;
+  }
+
+  if (filter->Group &&
+      (!item->Group || strcmp(item->Group, filter->Group) != 0)) {
+    return false;
+  }
+
+  if (filter->Prefix) {
+    const size_t len = strlen(filter->Prefix);
+    return len <= nameLen && memcmp(item->Name, filter->Prefix, len) == 0;
+  }
+
+  return true;
+}
+
+// HelpAppendItems renders the selected items, which are stride bytes apart
+// since they are embedded in options and commands, and returns how many
+// were selected.
+static size_t HelpAppendItems(HelpWriter *writer, const HelpItem *items,
+                              size_t stride, size_t len, const char *prefix,
+                              const FlagsHelpFilter *filter) {
+  const char *base = (const char *)items;
+  size_t maxLen = 0;
+  size_t selected = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    const HelpItem *item = (const HelpItem *)(base + i * stride);
+    const size_t nameLen = HelpNameLen(item);
+    if (HelpSelected(item, nameLen, filter)) {
+      const size_t totalLen = TabCharLen + 1 + nameLen;
+      maxLen = totalLen > maxLen ? totalLen : maxLen;
+      selected++;
+    }
+  }
+
+  if (selected == 0) {
+    return 0;
+  }
+
+  const size_t prefixLen = strlen(prefix);
+  const size_t maxTabsTaken = ComputeTabsTaken(maxLen);
+  for (size_t i = 0; i < len; i++) {
+    const HelpItem *item = (const HelpItem *)(base + i * stride);
+    const size_t nameLen = HelpNameLen(item);
+    if (!HelpSelected(item, nameLen, filter)) {
+      continue;
+    }
+
+    const size_t tabsTaken = ComputeTabsTaken(TabCharLen + 1 + nameLen);
+    HelpAppend(writer, prefix, prefixLen);
+    HelpAppend(writer, item->Name, nameLen);
+    HelpAppendTabs(writer, maxTabsTaken - tabsTaken + 1);
+    HelpAppendString(writer, item->Help);
+    HelpAppend(writer, "\n", 1);
+  }
+
+  HelpAppend(writer, "\n", 1);
+  return selected;
+}
+
+FlagOption FlagsGroup(FlagOption option, const char *group) {
+  option.Help.Group = group;
+  return option;
+}
+
+static void HelpFormatItems(HelpWriter *writer, const HelpItem *items,
+                            size_t len, const char *prefix,
+                            const FlagsHelpFilter *filter) {
+  if (HelpAppendItems(writer, items, sizeof(HelpItem), len, prefix, filter) ==
+      0) {
+    // an empty list is still terminated like the items would have been
+    HelpAppend(writer, "\n", 1);
+  }
+}
+
+size_t FlagsFormatHelpItems(char *buf, size_t cap, const HelpItem *items,
+                            size_t len, const char *prefix,
+                            const FlagsHelpFilter *filter) {
+  HelpWriter writer = {.Buf = buf, .Cap = cap, .Len = 0};
+  HelpFormatItems(&writer, items, len, prefix, filter);
+  return HelpFinish(&writer);
+}
+
+size_t FlagsFormatSchemaHelp(char *buf, size_t cap,
+                             const FlagsSchemaEntry *entries, size_t len,
+                             const FlagsHelpFilter *filter) {
+  HelpWriter writer = {.Buf = buf, .Cap = cap, .Len = 0};
+  if (len == 0 || HelpAppendItems(&writer, &entries[0].Help,
+                                  sizeof(FlagsSchemaEntry), len, "\t-",
+                                  filter) == 0) {
+    HelpAppend(&writer, "\n", 1);
+  }
+  return HelpFinish(&writer);
+}
+
+static void HelpFormat(HelpWriter *writer, const char *app,
+                       const Flags *flags, const FlagsHelpFilter *filter) {
+  const FlagOptions *options = &flags->Options;
+  const FlagCommands *cmds = &flags->Commands;
+
+  HelpAppendString(writer, "\nUSAGE:\t");
+  HelpAppendString(writer, app);
+  HelpAppendString(writer, cmds->CommandsLen > 0 ? " [OPTIONS] COMMAND\n\n"
+                                                 : " [OPTIONS]\n\n");
+
+  // the section headers are only kept when one of their items is selected
+  size_t header = writer->Len;
+  HelpAppendString(writer, "OPTIONS:\n");
+  if (options->OptionsLen == 0 ||
+      !HelpAppendItems(writer, &options->Options[0].Help, sizeof(FlagOption),
+                       options->OptionsLen, "\t-", filter)) {
+    writer->Len = header;
+  }
+
+  header = writer->Len;
+  HelpAppendString(writer, "COMMANDS:\n");
+  if (cmds->CommandsLen == 0 ||
+      !HelpAppendItems(writer, &cmds->Commands[0].Help, sizeof(FlagCommand),
+                       cmds->CommandsLen, "\t", filter)) {
+    writer->Len = header;
+  }
+}
+
+size_t FlagsFormatHelp(char *buf, size_t cap, const char *app,
+                       const Flags *flags, const FlagsHelpFilter *filter) {
+  HelpWriter writer = {.Buf = buf, .Cap = cap, .Len = 0};
+  HelpFormat(&writer, app, flags, filter);
+  return HelpFinish(&writer);
+}
+
+// HelpFlush writes what writer rendered to fd and releases its buffer.
+static FlagError HelpFlush(HelpWriter *writer, int fd) {
+  const FlagError err = writer->Failed
+                            ? FlagErrNoMemory
+                            : FlagsWriteAll(fd, writer->Buf, writer->Len);
+  if (writer->Heap) {
+    free(writer->Buf);
+  }
+  return err;
+}
+
+FlagError FlagsWriteHelp(int fd, const char *app, const Flags *flags,
+                         const FlagsHelpFilter *filter) {
+  char stack[4096];
+  HelpWriter writer = {
+      .Buf = stack, .Cap = sizeof(stack), .Len = 0, .Grow = true};
+  HelpFormat(&writer, app, flags, filter);
+  return HelpFlush(&writer, fd);
+}
+
+void PrintHelpItems(HelpItem *items, size_t len, const char *prefix) {
+  char stack[4096];
+  HelpWriter writer = {
+      .Buf = stack, .Cap = sizeof(stack), .Len = 0, .Grow = true};
+  HelpFormatItems(&writer, items, len, prefix, NULL);
+  HelpFlush(&writer, STDERR_FILENO);
+}
+
+void FlagsPrintHelp(const char *app, Flags *flags) {
+  FlagsWriteHelp(STDERR_FILENO, app, flags, NULL);
+}
@@ -0,0 +1,39 @@
+#ifndef FLAGS_HELP_H_
+#define FLAGS_HELP_H_
+
+#include <stddef.h>
+
+#include "flags.h"
+#include "schema.h"
+
+// FlagsHelpFilter selects the items of a help screen. Items must start
+// with Prefix and belong to Group when those are not NULL.
+typedef struct FlagsHelpFilter {
+  const char *Prefix;
+  const char *Group;
+} FlagsHelpFilter;
+
+// FlagsGroup returns option assigned to group, so that it can be used
+// within FlagOptionsDeclare.
+FlagOption FlagsGroup(FlagOption option, const char *group);
+
+// FlagsFormatHelp renders the help screen of flags into buf like snprintf:
+// at most cap - 1 bytes are written followed by a NUL byte, and the length
+// of the whole screen is returned so that a larger buffer can be retried.
+// filter may be NULL to render every item.
+size_t FlagsFormatHelp(char *buf, size_t cap, const char *app,
+                       const Flags *flags, const FlagsHelpFilter *filter);
+size_t FlagsFormatHelpItems(char *buf, size_t cap, const HelpItem *items,
+                            size_t len, const char *prefix,
+                            const FlagsHelpFilter *filter);
+size_t FlagsFormatSchemaHelp(char *buf, size_t cap,
+                             const FlagsSchemaEntry *entries, size_t len,
+                             const FlagsHelpFilter *filter);
+
+// FlagsWriteHelp renders the help screen of flags in a single pass, into a
+// buffer that grows as needed, and writes it to fd at once, retrying writes
+// interrupted by a signal.
+FlagError FlagsWriteHelp(int fd, const char *app, const Flags *flags,
+                         const FlagsHelpFilter *filter);
+
+#endif // FLAGS_HELP_H_
@@ -0,0 +1,208 @@
+#include "index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "strings.h"
+
+static size_t FlagIndexCapFor(size_t len) {
+  // keep the load factor at or below one half so probe chains stay short
+  size_t cap = 8;
+  while (cap < len * 2) {
+    cap *= 2;
+  }
+  return cap;
+}
+
+bool FlagIndexInit(FlagIndex *index, size_t len) {
+  const size_t cap = FlagIndexCapFor(len);
+  FlagIndexSlot *slots = calloc(cap, sizeof(FlagIndexSlot));
+  if (!slots) {
+    return false;
+  }
+
+  index->Cap = cap;
+  index->Len = 0;
+  index->Slots = slots;
+  index->Folded = false;
+  return true;
+}
+
+bool FlagIndexInitFolded(FlagIndex *index, size_t len) {
+  if (!FlagIndexInit(index, len)) {
+    return false;
+  }
+
+  index->Folded = true;
+  return true;
+}
+
+static uint64_t FlagIndexHash(const FlagIndex *index, const char *name,
+                              size_t nameLen) {
+  return index->Folded ? StringHashFolded(name, nameLen)
+                       : StringHash(name, nameLen);
+}
+
+static bool FlagIndexMatch(const FlagIndex *index, const FlagIndexSlot *slot,
+                           uint64_t hash, const char *name, size_t nameLen) {
+  if (slot->Hash != hash) {
+    return false;
+  }
+
+  return index->Folded
+             ? StringFoldEqualsWithLen(slot->Name, slot->NameLen, name, nameLen)
+             : StringEqualsWithLen(slot->Name, slot->NameLen, name, nameLen);
+}
+
+bool FlagIndexIsCompiled(const FlagIndex *index) {
+  return index->Slots != NULL;
+}
+
+bool FlagIndexInsert(FlagIndex *index, const char *name, size_t nameLen,
+                     size_t pos) {
+  if (index->Len * 2 >= index->Cap) {
+    return false;
+  }
+
+  const uint64_t hash = FlagIndexHash(index, name, nameLen);
+  const size_t mask = index->Cap - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    FlagIndexSlot *slot = &index->Slots[i];
+    if (slot->Name == NULL) {
+      slot->Hash = hash;
+      slot->Name = name;
+      slot->NameLen = nameLen;
+      slot->Pos = pos;
+      index->Len++;
+      return true;
+    }
+
+    if (FlagIndexMatch(index, slot, hash, name, nameLen)) {
+      return false;
+    }
+  }
+}
+
+bool FlagIndexFind(const FlagIndex *index, const char *name, size_t nameLen,
+                   size_t *pos) {
+  return FlagIndexFindStats(index, name, nameLen, pos, NULL);
+}
+
+bool FlagIndexFindStats(const FlagIndex *index, const char *name,
+                        size_t nameLen, size_t *pos, FlagsStats *stats) {
+  (void)stats;
+  const uint64_t hash = FlagIndexHash(index, name, nameLen);
+  const size_t mask = index->Cap - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const FlagIndexSlot *slot = &index->Slots[i];
+    FlagsStatsAdd(stats, Probes, 1);
+    if (slot->Name == NULL) {
+      return false;
+    }
+
+    FlagsStatsAdd(stats, Compares, slot->Hash == hash);
+    if (FlagIndexMatch(index, slot, hash, name, nameLen)) {
+      *pos = slot->Pos;
+      return true;
+    }
+  }
+}
+
+void FlagIndexRelease(FlagIndex *index) {
+  free(index->Slots);
+  index->Slots = NULL;
+  index->Cap = 0;
+  index->Len = 0;
+}
+
+bool FlagPrefixIndexInit(FlagPrefixIndex *index, size_t len) {
+  // one extra entry keeps the allocation non empty
+  FlagPrefixEntry *entries = calloc(len + 1, sizeof(FlagPrefixEntry));
+  if (!entries) {
+    return false;
+  }
+
+  index->Cap = len;
+  index->Len = 0;
+  index->Entries = entries;
+  return true;
+}
+
+bool FlagPrefixIndexIsCompiled(const FlagPrefixIndex *index) {
+  return index->Entries != NULL;
+}
+
+bool FlagPrefixIndexAdd(FlagPrefixIndex *index, const char *name,
+                        size_t nameLen, const char *help) {
+  if (index->Len == index->Cap) {
+    return false;
+  }
+
+  FlagPrefixEntry *entry = &index->Entries[index->Len++];
+  entry->Name = name;
+  entry->NameLen = nameLen;
+  entry->Help = help;
+  return true;
+}
+
+static int FlagPrefixCompare(const void *a, const void *b) {
+  const FlagPrefixEntry *ea = a;
+  const FlagPrefixEntry *eb = b;
+  const size_t len = ea->NameLen < eb->NameLen ? ea->NameLen : eb->NameLen;
+  const int cmp = memcmp(ea->Name, eb->Name, len);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return (ea->NameLen > eb->NameLen) - (ea->NameLen < eb->NameLen);
+}
+
+void FlagPrefixIndexSort(FlagPrefixIndex *index) {
+  qsort(index->Entries, index->Len, sizeof(FlagPrefixEntry),
+        &FlagPrefixCompare);
+}
+
+// FlagPrefixOrder compares the start of entry with prefix, so that every
+// entry starting with prefix orders the same as it.
+static int FlagPrefixOrder(const FlagPrefixEntry *entry, const char *prefix,
+                           size_t len) {
+  const size_t n = entry->NameLen < len ? entry->NameLen : len;
+  const int cmp = memcmp(entry->Name, prefix, n);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return entry->NameLen < len ? -1 : 0;
+}
+
+void FlagPrefixIndexRange(const FlagPrefixIndex *index, const char *prefix,
+                          size_t len, size_t *first, size_t *last) {
+  size_t lo = 0;
+  size_t hi = index->Len;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (FlagPrefixOrder(&index->Entries[mid], prefix, len) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *first = lo;
+
+  hi = index->Len;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (FlagPrefixOrder(&index->Entries[mid], prefix, len) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *last = lo;
+}
+
+void FlagPrefixIndexRelease(FlagPrefixIndex *index) {
+  free(index->Entries);
+  index->Entries = NULL;
+  index->Cap = 0;
+  index->Len = 0;
+}
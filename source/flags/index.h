@@ -0,0 +1,67 @@
+#ifndef FLAGS_INDEX_H_
+#define FLAGS_INDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct FlagsStats;
+
+typedef struct FlagIndexSlot {
+  uint64_t Hash;
+  const char *Name;
+  size_t NameLen;
+  size_t Pos;
+} FlagIndexSlot;
+
+// FlagIndex is an open addressing hash table from names to their position
+// in an options or commands array. Slots keep the full hash and the name
+// length so that probing only compares names whose hash and length match.
+// A Folded index ignores the case of ASCII letters.
+typedef struct FlagIndex {
+  size_t Cap;
+  size_t Len;
+  FlagIndexSlot *Slots;
+  bool Folded;
+} FlagIndex;
+
+bool FlagIndexInit(FlagIndex *index, size_t len);
+bool FlagIndexInitFolded(FlagIndex *index, size_t len);
+bool FlagIndexIsCompiled(const FlagIndex *index);
+bool FlagIndexInsert(FlagIndex *index, const char *name, size_t nameLen,
+                     size_t pos);
+bool FlagIndexFind(const FlagIndex *index, const char *name, size_t nameLen,
+                   size_t *pos);
+// FlagIndexFindStats is FlagIndexFind that also counts its probes and name
+// comparisons into stats, which may be NULL.
+bool FlagIndexFindStats(const FlagIndex *index, const char *name,
+                        size_t nameLen, size_t *pos, struct FlagsStats *stats);
+void FlagIndexRelease(FlagIndex *index);
+
+typedef struct FlagPrefixEntry {
+  const char *Name;
+  size_t NameLen;
+  const char *Help;
+} FlagPrefixEntry;
+
+// FlagPrefixIndex keeps names sorted bytewise so that every name starting
+// with a prefix is found with two binary searches, for completion.
+typedef struct FlagPrefixIndex {
+  size_t Cap;
+  size_t Len;
+  FlagPrefixEntry *Entries;
+} FlagPrefixIndex;
+
+bool FlagPrefixIndexInit(FlagPrefixIndex *index, size_t len);
+bool FlagPrefixIndexIsCompiled(const FlagPrefixIndex *index);
+bool FlagPrefixIndexAdd(FlagPrefixIndex *index, const char *name,
+                        size_t nameLen, const char *help);
+void FlagPrefixIndexSort(FlagPrefixIndex *index);
+
+// FlagPrefixIndexRange sets first and last so that the entries in between,
+// last excluded, are those whose name starts with prefix.
+void FlagPrefixIndexRange(const FlagPrefixIndex *index, const char *prefix,
+                          size_t len, size_t *first, size_t *last);
+void FlagPrefixIndexRelease(FlagPrefixIndex *index);
+
+#endif // FLAGS_INDEX_H_
@@ -0,0 +1,156 @@
+#include "lazy.h"
+
+#include <string.h>
+
+FlagError FlagsResolve(FlagOption *option) {
+  if (!option->Pending) {
+    return Ok;
+  }
+
+  FlagError err = FlagsApplyOption(option, option->Raw.Ptr, option->Raw.Len);
+  if (!err) {
+    option->Pending = false;
+  }
+  return err;
+}
+
+FlagError FlagsValidate(Flags *flags, int *index) {
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagError err = FlagsResolve(&flags->Options.Options[i]);
+    if (err) {
+      *index = (int)i;
+      return err;
+    }
+  }
+
+  return Ok;
+}
+
+static FlagError FlagsGet(Flags *flags, const char *name, FlagType type,
+                          const void **value) {
+  FlagOption *option = FlagsLookupOption(flags, name, strlen(name));
+  if (!option) {
+    return FlagErrUnknownFlag;
+  }
+
+  if (option->Type != type) {
+    return FlagErrType;
+  }
+
+  FlagError err = FlagsResolve(option);
+  if (err) {
+    return err;
+  }
+
+  *value = option->Value;
+  return Ok;
+}
+
+FlagError FlagsGetBool(Flags *flags, const char *name, bool *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagBool, &ptr);
+  if (!err) {
+    *value = *(const bool *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetString(Flags *flags, const char *name, const char **value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagString, &ptr);
+  if (!err) {
+    *value = ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetStringView(Flags *flags, const char *name,
+                             StringView *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagStringView, &ptr);
+  if (!err) {
+    *value = *(const StringView *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetInt32(Flags *flags, const char *name, int32_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagInt32, &ptr);
+  if (!err) {
+    *value = *(const int32_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetInt64(Flags *flags, const char *name, int64_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagInt64, &ptr);
+  if (!err) {
+    *value = *(const int64_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetUint32(Flags *flags, const char *name, uint32_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagUint32, &ptr);
+  if (!err) {
+    *value = *(const uint32_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetUint64(Flags *flags, const char *name, uint64_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagUint64, &ptr);
+  if (!err) {
+    *value = *(const uint64_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetFloat(Flags *flags, const char *name, float *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagFloat, &ptr);
+  if (!err) {
+    *value = *(const float *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetDouble(Flags *flags, const char *name, double *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagDouble, &ptr);
+  if (!err) {
+    *value = *(const double *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetDuration(Flags *flags, const char *name, int64_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagDuration, &ptr);
+  if (!err) {
+    *value = *(const int64_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetByteSize(Flags *flags, const char *name, uint64_t *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagByteSize, &ptr);
+  if (!err) {
+    *value = *(const uint64_t *)ptr;
+  }
+  return err;
+}
+
+FlagError FlagsGetEnum(Flags *flags, const char *name, int *value) {
+  const void *ptr = NULL;
+  FlagError err = FlagsGet(flags, name, FlagEnum, &ptr);
+  if (!err) {
+    *value = *(const int *)ptr;
+  }
+  return err;
+}
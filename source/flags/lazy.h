@@ -0,0 +1,32 @@
+#ifndef FLAGS_LAZY_H_
+#define FLAGS_LAZY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+// FlagsResolve converts the text recorded for option by a lazy parse and
+// caches the result in its Value.
+FlagError FlagsResolve(FlagOption *option);
+
+// FlagsValidate resolves every pending option, for callers of lazy parsing
+// that still want every error up front. On error index is set to the
+// position of the offending option.
+FlagError FlagsValidate(Flags *flags, int *index);
+
+FlagError FlagsGetBool(Flags *flags, const char *name, bool *value);
+FlagError FlagsGetString(Flags *flags, const char *name, const char **value);
+FlagError FlagsGetStringView(Flags *flags, const char *name,
+                             StringView *value);
+FlagError FlagsGetInt32(Flags *flags, const char *name, int32_t *value);
+FlagError FlagsGetInt64(Flags *flags, const char *name, int64_t *value);
+FlagError FlagsGetUint32(Flags *flags, const char *name, uint32_t *value);
+FlagError FlagsGetUint64(Flags *flags, const char *name, uint64_t *value);
+FlagError FlagsGetFloat(Flags *flags, const char *name, float *value);
+FlagError FlagsGetDouble(Flags *flags, const char *name, double *value);
+FlagError FlagsGetDuration(Flags *flags, const char *name, int64_t *value);
+FlagError FlagsGetByteSize(Flags *flags, const char *name, uint64_t *value);
+FlagError FlagsGetEnum(Flags *flags, const char *name, int *value);
+
+#endif // FLAGS_LAZY_H_
@@ -1,23 +1,29 @@
 #include "parse.h"
 
-#include <errno.h>
 #include <string.h>
 
 #include "strings.h"
 
+typedef struct ParseBoolWord {
+  const char *Word;
+  bool Value;
+} ParseBoolWord;
+
+// ParseBoolWords is indexed by length, which tells every word apart, so a
+// value needs a single case folded comparison to be classified.
+static const ParseBoolWord ParseBoolWords[] = {
+    [2] = {"on", true},      [3] = {"off", false},
+    [4] = {"true", true},    [5] = {"false", false},
+    [7] = {"enabled", true}, [8] = {"disabled", false},
+};
+
 bool ParseBool(bool *value, const char *s, size_t len) {
   int64_t parsed;
+  const size_t words = sizeof(ParseBoolWords) / sizeof(ParseBoolWords[0]);
+  const ParseBoolWord *word = len < words ? &ParseBoolWords[len] : NULL;
 
-  if (StringCaseEqualsWithLen(s, len, "true", 4) ||
-      StringCaseEqualsWithLen(s, len, "on", 2) ||
-      StringCaseEqualsWithLen(s, len, "enabled", 7)) {
-    *value = true;
-    return true;
-
-  } else if (StringCaseEqualsWithLen(s, len, "false", 5) ||
-             StringCaseEqualsWithLen(s, len, "off", 3) ||
-             StringCaseEqualsWithLen(s, len, "disabled", 8)) {
-    *value = false;
+  if (word && word->Word && StringFoldEqualsWithLen(s, len, word->Word, len)) {
+    *value = word->Value;
     return true;
 
   } else if (ParseInt64(&parsed, s, len)) {
@@ -39,12 +45,23 @@ bool ParseString(char *value, size_t maxLen, const char *s, size_t len) {
   return true;
 }
 
+static bool ParseIsTrailingBlank(const char *s, size_t len,
+                                 const char *endptr) {
+  return StringIsBlankWithLen(endptr, len - (size_t)(endptr - s));
+}
+
+bool ParseStringView(StringView *value, const char *s, size_t len) {
+  value->Ptr = s;
+  value->Len = len;
+  return true;
+}
+
 bool ParseInt32(int32_t *value, const char *s, size_t len) {
   const char *endptr = NULL;
-  int64_t parsed = StringToInt64(s, len, &endptr, 10);
+  int64_t parsed;
+  NumStatus status = StringParseInt64(s, len, &parsed, &endptr);
 
-  if (errno || ((size_t)(endptr - s + 1) < len && !CharIsBlank(*endptr))) {
-    errno = 0;
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
   } else if (parsed > INT32_MAX) {
@@ -61,58 +78,160 @@ bool ParseInt32(int32_t *value, const char *s, size_t len) {
 
 bool ParseInt64(int64_t *value, const char *s, size_t len) {
   const char *endptr = NULL;
-  int64_t parsed = StringToInt64(s, len, &endptr, 10);
+  int64_t parsed;
+  NumStatus status = StringParseInt64(s, len, &parsed, &endptr);
 
-  if (errno || ((size_t)(endptr - s + 1) < len && !CharIsBlank(*endptr))) {
-    errno = 0;
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
-  } else if (parsed > INT64_MAX) {
+  } else {
+    *value = parsed;
+    return true;
+  }
+}
+
+bool ParseUint32(uint32_t *value, const char *s, size_t len) {
+  const char *endptr = NULL;
+  uint64_t parsed;
+  NumStatus status = StringParseUint64(s, len, &parsed, &endptr);
+
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
-  } else if (parsed < INT64_MIN) {
+  } else if (parsed > UINT32_MAX) {
     return false;
 
   } else {
-    *value = (int64_t)(parsed);
+    *value = (uint32_t)(parsed);
     return true;
   }
 }
 
-bool ParseUint32(uint32_t *value, const char *s, size_t len) {
+bool ParseUint64(uint64_t *value, const char *s, size_t len) {
   const char *endptr = NULL;
-  uint64_t parsed = StringToUint64(s, len, &endptr, 10);
+  uint64_t parsed;
+  NumStatus status = StringParseUint64(s, len, &parsed, &endptr);
 
-  if (errno || ((size_t)(endptr - s + 1) < len && !CharIsBlank(*endptr))) {
-    errno = 0;
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
-  } else if (parsed > UINT32_MAX) {
+  } else {
+    *value = parsed;
+    return true;
+  }
+}
+
+bool ParseFloat(float *value, const char *s, size_t len) {
+  const char *endptr = NULL;
+  float parsed;
+  NumStatus status = StringParseFloat(s, len, &parsed, &endptr);
+
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
   } else {
-    *value = (int64_t)(parsed);
+    *value = parsed;
     return true;
   }
 }
 
-bool ParseUint64(uint64_t *value, const char *s, size_t len) {
+bool ParseDouble(double *value, const char *s, size_t len) {
+  const char *endptr = NULL;
+  double parsed;
+  NumStatus status = StringParseDouble(s, len, &parsed, &endptr);
+
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
+    return false;
+
+  } else {
+    *value = parsed;
+    return true;
+  }
+}
+
+bool ParseDuration(int64_t *value, const char *s, size_t len) {
   const char *endptr = NULL;
-  uint64_t parsed = StringToUint64(s, len, &endptr, 10);
+  int64_t parsed;
+  NumStatus status = StringParseDuration(s, len, &parsed, &endptr);
 
-  if (errno || ((size_t)(endptr - s + 1) < len && !CharIsBlank(*endptr))) {
-    errno = 0;
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
-  } else if (parsed > UINT64_MAX) {
+  } else {
+    *value = parsed;
+    return true;
+  }
+}
+
+bool ParseByteSize(uint64_t *value, const char *s, size_t len) {
+  const char *endptr = NULL;
+  uint64_t parsed;
+  NumStatus status = StringParseByteSize(s, len, &parsed, &endptr);
+
+  if (status != NumOk || !ParseIsTrailingBlank(s, len, endptr)) {
     return false;
 
   } else {
-    *value = (uint64_t)(parsed);
+    *value = parsed;
     return true;
   }
 }
 
+typedef bool(ParseListItem)(FlagList *list, size_t pos, const char *s,
+                            size_t len);
+
+static bool ParseList(FlagList *list, const char *s, size_t len,
+                      ParseListItem *item) {
+  // values are appended after the ones from previous occurrences and split
+  // on ',' so that repeated and delimited values can be mixed
+  const char *end = s + len;
+  bool ok = true;
+  while (s < end) {
+    const char *delim = StringFindChar(s, (size_t)(end - s), ',');
+    const size_t pos = list->Len++;
+    if (pos >= list->Cap) {
+      ok = false;
+    } else if (ok && !item(list, pos, s, (size_t)(delim - s))) {
+      return false;
+    }
+
+    s = delim < end ? delim + 1 : end;
+    if (delim + 1 == end) {
+      // a trailing delimiter leaves an empty value
+      return false;
+    }
+  }
+
+  return ok;
+}
+
+static bool ParseInt64ListItem(FlagList *list, size_t pos, const char *s,
+                               size_t len) {
+  return ParseInt64((int64_t *)list->Values + pos, s, len);
+}
+
+static bool ParseUint32ListItem(FlagList *list, size_t pos, const char *s,
+                                size_t len) {
+  return ParseUint32((uint32_t *)list->Values + pos, s, len);
+}
+
+static bool ParseStringViewListItem(FlagList *list, size_t pos, const char *s,
+                                    size_t len) {
+  return len > 0 && ParseStringView((StringView *)list->Values + pos, s, len);
+}
+
+bool ParseInt64List(FlagList *list, const char *s, size_t len) {
+  return ParseList(list, s, len, ParseInt64ListItem);
+}
+
+bool ParseUint32List(FlagList *list, const char *s, size_t len) {
+  return ParseList(list, s, len, ParseUint32ListItem);
+}
+
+bool ParseStringViewList(FlagList *list, const char *s, size_t len) {
+  return ParseList(list, s, len, ParseStringViewListItem);
+}
+
 bool ParseFuncBool(void *value, size_t maxLen, const char *s, size_t len) {
   (void)(maxLen);
   return ParseBool((bool *)value, s, len);
@@ -122,6 +241,12 @@ bool ParseFuncString(void *value, size_t maxLen, const char *s, size_t len) {
   return ParseString((char *)value, maxLen, s, len);
 }
 
+bool ParseFuncStringView(void *value, size_t maxLen, const char *s,
+                         size_t len) {
+  (void)(maxLen);
+  return ParseStringView((StringView *)value, s, len);
+}
+
 bool ParseFuncInt32(void *value, size_t maxLen, const char *s, size_t len) {
   (void)(maxLen);
   return ParseInt32((int32_t *)value, s, len);
@@ -141,3 +266,43 @@ bool ParseFuncUint64(void *value, size_t maxLen, const char *s, size_t len) {
   (void)(maxLen);
   return ParseUint64((uint64_t *)value, s, len);
 }
+
+bool ParseFuncFloat(void *value, size_t maxLen, const char *s, size_t len) {
+  (void)(maxLen);
+  return ParseFloat((float *)value, s, len);
+}
+
+bool ParseFuncDouble(void *value, size_t maxLen, const char *s, size_t len) {
+  (void)(maxLen);
+  return ParseDouble((double *)value, s, len);
+}
+
+bool ParseFuncDuration(void *value, size_t maxLen, const char *s,
+                       size_t len) {
+  (void)(maxLen);
+  return ParseDuration((int64_t *)value, s, len);
+}
+
+bool ParseFuncByteSize(void *value, size_t maxLen, const char *s,
+                       size_t len) {
+  (void)(maxLen);
+  return ParseByteSize((uint64_t *)value, s, len);
+}
+
+bool ParseFuncInt64List(void *value, size_t maxLen, const char *s,
+                        size_t len) {
+  (void)(maxLen);
+  return ParseInt64List((FlagList *)value, s, len);
+}
+
+bool ParseFuncUint32List(void *value, size_t maxLen, const char *s,
+                         size_t len) {
+  (void)(maxLen);
+  return ParseUint32List((FlagList *)value, s, len);
+}
+
+bool ParseFuncStringViewList(void *value, size_t maxLen, const char *s,
+                             size_t len) {
+  (void)(maxLen);
+  return ParseStringViewList((FlagList *)value, s, len);
+}
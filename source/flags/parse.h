@@ -5,12 +5,35 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "strings.h"
+
+// FlagList is caller provided storage for list valued options. Values holds
+// Cap elements and Len counts every element parsed so far. When Len grows
+// past Cap parsing fails and Len reports the capacity that was needed.
+typedef struct FlagList {
+  void *Values;
+  size_t Cap;
+  size_t Len;
+} FlagList;
+
+#define FlagListDeclare(name, type, cap)                                       \
+  type __##name[cap];                                                          \
+  FlagList name = {.Values = __##name, .Cap = cap, .Len = 0}
+
 bool ParseString(char *value, size_t maxLen, const char *s, size_t len);
+bool ParseStringView(StringView *value, const char *s, size_t len);
 bool ParseBool(bool *value, const char *s, size_t len);
 bool ParseInt32(int32_t *value, const char *s, size_t len);
 bool ParseInt64(int64_t *value, const char *s, size_t len);
 bool ParseUint32(uint32_t *value, const char *s, size_t len);
 bool ParseUint64(uint64_t *value, const char *s, size_t len);
+bool ParseFloat(float *value, const char *s, size_t len);
+bool ParseDouble(double *value, const char *s, size_t len);
+bool ParseDuration(int64_t *value, const char *s, size_t len);
+bool ParseByteSize(uint64_t *value, const char *s, size_t len);
+bool ParseInt64List(FlagList *list, const char *s, size_t len);
+bool ParseUint32List(FlagList *list, const char *s, size_t len);
+bool ParseStringViewList(FlagList *list, const char *s, size_t len);
 
 typedef bool (*ParseFunc)(void *value, size_t maxLen, const char *s,
                           size_t len);
@@ -19,6 +42,9 @@ bool ParseFuncBool(void *value, size_t maxLen, const char *s, size_t len);
 
 bool ParseFuncString(void *value, size_t maxLen, const char *s, size_t len);
 
+bool ParseFuncStringView(void *value, size_t maxLen, const char *s,
+                         size_t len);
+
 bool ParseFuncInt32(void *value, size_t maxLen, const char *s, size_t len);
 
 bool ParseFuncInt64(void *value, size_t maxLen, const char *s, size_t len);
@@ -27,4 +53,23 @@ bool ParseFuncUint32(void *value, size_t maxLen, const char *s, size_t len);
 
 bool ParseFuncUint64(void *value, size_t maxLen, const char *s, size_t len);
 
+bool ParseFuncFloat(void *value, size_t maxLen, const char *s, size_t len);
+
+bool ParseFuncDouble(void *value, size_t maxLen, const char *s, size_t len);
+
+bool ParseFuncDuration(void *value, size_t maxLen, const char *s,
+                       size_t len);
+
+bool ParseFuncByteSize(void *value, size_t maxLen, const char *s,
+                       size_t len);
+
+bool ParseFuncInt64List(void *value, size_t maxLen, const char *s,
+                        size_t len);
+
+bool ParseFuncUint32List(void *value, size_t maxLen, const char *s,
+                         size_t len);
+
+bool ParseFuncStringViewList(void *value, size_t maxLen, const char *s,
+                             size_t len);
+
 #endif // VALUES_PARSE_H_
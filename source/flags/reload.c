@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+
+#include "reload.h"
+
+#include <poll.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif
+
+// a reader slot is free, joined but not reading, or holds the epoch at
+// which its reader acquired the current snapshot
+#define FlagsReaderFree 0
+#define FlagsReaderIdle UINT64_MAX
+
+// FlagsReloaderRegister enables membarrier for the process, so that the
+// reclaiming thread can fence on behalf of readers.
+static bool FlagsReloaderRegister(void) {
+#if defined(__linux__) && defined(SYS_membarrier)
+  const long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+  return cmds >= 0 && (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+         syscall(SYS_membarrier,
+                 MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+// FlagsReloaderFence orders the stores of the reclaiming thread before its
+// loads of the reader slots, and those of every reader too when they rely
+// on it.
+static void FlagsReloaderFence(const FlagsReloader *reloader) {
+  atomic_thread_fence(memory_order_seq_cst);
+#if defined(__linux__) && defined(SYS_membarrier)
+  if (reloader->Asymmetric &&
+      syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0) != 0) {
+    // registered processes cannot fail, but readers must never be unfenced
+    abort();
+  }
+#else
+  (void)reloader;
+#endif
+}
+
+static size_t FlagsSnapshotHeaderSize(void) {
+  const size_t align = alignof(max_align_t);
+  return (sizeof(FlagsSnapshot) + align - 1) / align * align;
+}
+
+static FlagsSnapshot *FlagsSnapshotNew(const FlagsReloader *reloader) {
+  const size_t header = FlagsSnapshotHeaderSize();
+  FlagsSnapshot *snapshot = malloc(header + reloader->Size);
+  if (!snapshot) {
+    return NULL;
+  }
+
+  snapshot->Retired = NULL;
+  snapshot->Files = NULL;
+  snapshot->Generation = 0;
+  snapshot->RetiredAt = 0;
+  snapshot->Record = (char *)snapshot + header;
+  memcpy(snapshot->Record, reloader->Defaults, reloader->Size);
+  return snapshot;
+}
+
+static void FlagsSnapshotFree(FlagsSnapshot *snapshot) {
+  if (snapshot) {
+    FlagFilesFree(snapshot->Files);
+    free(snapshot);
+  }
+}
+
+static bool FlagsReloaderSplitPath(FlagsReloader *reloader,
+                                   const char *path) {
+  reloader->Path = strdup(path);
+  if (!reloader->Path) {
+    return false;
+  }
+
+  const char *slash = strrchr(path, '/');
+  if (!slash) {
+    reloader->Dir = strdup(".");
+    reloader->Base = reloader->Path;
+  } else {
+    reloader->Dir = strndup(path, (size_t)(slash - path) + 1);
+    reloader->Base = reloader->Path + (slash - path) + 1;
+  }
+  return reloader->Dir != NULL;
+}
+
+FlagError FlagsReloaderInit(FlagsReloader *reloader, const Flags *flags,
+                            const void *proto, size_t size,
+                            const char *path) {
+  memset(reloader, 0, sizeof(*reloader));
+  reloader->Flags = flags;
+  reloader->Proto = proto;
+  reloader->Size = size;
+  reloader->Inotify = -1;
+  atomic_init(&reloader->Current, NULL);
+  atomic_init(&reloader->Epoch, 1);
+  for (size_t i = 0; i < FlagsMaxReaders; i++) {
+    atomic_init(&reloader->Readers[i].Epoch, FlagsReaderFree);
+  }
+  reloader->Asymmetric = FlagsReloaderRegister();
+
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    const FlagType type = flags->Options.Options[i].Type;
+    if (type == FlagInt64List || type == FlagUint32List ||
+        type == FlagStringViewList || type == FlagAtomicString) {
+      // list elements and cell strings live outside the record and cannot
+      // be snapshotted
+      return FlagErrType;
+    }
+  }
+
+  reloader->Defaults = malloc(size);
+  reloader->Changed = calloc(flags->Options.OptionsLen + 1, sizeof(size_t));
+  if (!reloader->Defaults || !reloader->Changed ||
+      !FlagsReloaderSplitPath(reloader, path)) {
+    FlagsReloaderRelease(reloader);
+    return FlagErrNoMemory;
+  }
+  memcpy(reloader->Defaults, proto, size);
+
+#ifdef __linux__
+  reloader->Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (reloader->Inotify < 0 ||
+      inotify_add_watch(reloader->Inotify, reloader->Dir,
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+    FlagsReloaderRelease(reloader);
+    return FlagErrFile;
+  }
+#endif
+
+  FlagError err = FlagsReloaderReload(reloader);
+  if (err) {
+    FlagsReloaderRelease(reloader);
+  }
+  return err;
+}
+
+void FlagsReloaderOnReload(FlagsReloader *reloader, FlagsReloadFunc *func,
+                           void *ctx) {
+  reloader->OnReload = func;
+  reloader->Ctx = ctx;
+}
+
+FlagError FlagsReloaderJoin(FlagsReloader *reloader, size_t *reader) {
+  for (size_t i = 0; i < FlagsMaxReaders; i++) {
+    uint64_t expected = FlagsReaderFree;
+    if (atomic_compare_exchange_strong(&reloader->Readers[i].Epoch,
+                                       &expected, FlagsReaderIdle)) {
+      *reader = i;
+      return Ok;
+    }
+  }
+  return FlagErrNoMemory;
+}
+
+void FlagsReloaderLeave(FlagsReloader *reloader, size_t reader) {
+  atomic_store(&reloader->Readers[reader].Epoch, FlagsReaderFree);
+}
+
+const void *FlagsReloaderAcquire(FlagsReloader *reloader, size_t reader) {
+  return FlagsReloaderSnapshot(reloader, reader)->Record;
+}
+
+const FlagsSnapshot *FlagsReloaderSnapshot(FlagsReloader *reloader,
+                                           size_t reader) {
+  // the epoch is published before Current is read: a reader whose epoch
+  // is at least the retire epoch of a snapshot read Current after it was
+  // replaced and cannot hold it, while one that read the replaced snapshot
+  // has a smaller epoch in its slot by the time FlagsReloaderFence returns
+  _Atomic(uint64_t) *slot = &reloader->Readers[reader].Epoch;
+  const uint64_t epoch =
+      atomic_load_explicit(&reloader->Epoch, memory_order_acquire);
+  atomic_store_explicit(slot, epoch, memory_order_relaxed);
+  if (reloader->Asymmetric) {
+    atomic_signal_fence(memory_order_seq_cst);
+  } else {
+    atomic_thread_fence(memory_order_seq_cst);
+  }
+  return atomic_load_explicit(&reloader->Current, memory_order_acquire);
+}
+
+void FlagsReloaderDone(FlagsReloader *reloader, size_t reader) {
+  atomic_store_explicit(&reloader->Readers[reader].Epoch, FlagsReaderIdle,
+                        memory_order_release);
+}
+
+static size_t FlagsReloaderDiff(FlagsReloader *reloader,
+                                const FlagsSnapshot *prev,
+                                const FlagsSnapshot *next) {
+  const FlagOptions *options = &reloader->Flags->Options;
+  const FlagsRecord prevRecord = {
+      .Proto = reloader->Proto, .Size = reloader->Size, .Base = prev->Record};
+  const FlagsRecord nextRecord = {
+      .Proto = reloader->Proto, .Size = reloader->Size, .Base = next->Record};
+
+  size_t changed = 0;
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    const FlagOption *option = &options->Options[i];
+    if (!FlagsValueEquals(option, FlagsRecordValue(&prevRecord, option->Value),
+                          FlagsRecordValue(&nextRecord, option->Value))) {
+      reloader->Changed[changed++] = i;
+    }
+  }
+  return changed;
+}
+
+FlagError FlagsReloaderReload(FlagsReloader *reloader) {
+  FlagsSnapshot *next = FlagsSnapshotNew(reloader);
+  if (!next) {
+    return FlagErrNoMemory;
+  }
+
+  const FlagsRecord record = {
+      .Proto = reloader->Proto, .Size = reloader->Size, .Base = next->Record};
+  FlagError err = FlagsParseFileInto(reloader->Path, reloader->Flags, &record,
+                                     &next->Files);
+  if (err) {
+    FlagsSnapshotFree(next);
+    return err;
+  }
+
+  // only the reloading thread writes Current, so a relaxed load suffices
+  FlagsSnapshot *prev =
+      atomic_load_explicit(&reloader->Current, memory_order_relaxed);
+  next->Generation = prev ? prev->Generation + 1 : 0;
+  const size_t changed = prev ? FlagsReloaderDiff(reloader, prev, next) : 0;
+  if (prev && changed == 0) {
+    FlagsSnapshotFree(next);
+    return Ok;
+  }
+
+  atomic_store(&reloader->Current, next);
+  if (prev) {
+    prev->RetiredAt = atomic_fetch_add(&reloader->Epoch, 1) + 1;
+    prev->Retired = reloader->Retired;
+    reloader->Retired = prev;
+    FlagsReloaderReclaim(reloader);
+  }
+
+  if (reloader->OnReload && changed > 0) {
+    reloader->OnReload(reloader->Ctx, next, reloader->Changed, changed);
+  }
+  return Ok;
+}
+
+FlagError FlagsReloaderPoll(FlagsReloader *reloader, int timeoutMs) {
+#ifdef __linux__
+  struct pollfd pfd = {.fd = reloader->Inotify, .events = POLLIN};
+  if (poll(&pfd, 1, timeoutMs) <= 0) {
+    return Ok;
+  }
+
+  alignas(struct inotify_event) char buf[4096];
+  bool modified = false;
+  ssize_t n;
+  while ((n = read(reloader->Inotify, buf, sizeof(buf))) > 0) {
+    for (char *c = buf; c < buf + n;) {
+      const struct inotify_event *event = (const struct inotify_event *)c;
+      if (event->len > 0 && strcmp(event->name, reloader->Base) == 0) {
+        modified = true;
+      }
+      c += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  return modified ? FlagsReloaderReload(reloader) : Ok;
+#else
+  (void)timeoutMs;
+  return FlagsReloaderReload(reloader);
+#endif
+}
+
+void FlagsReloaderReclaim(FlagsReloader *reloader) {
+  FlagsReloaderFence(reloader);
+  uint64_t oldest = FlagsReaderIdle;
+  for (size_t i = 0; i < FlagsMaxReaders; i++) {
+    const uint64_t epoch = atomic_load(&reloader->Readers[i].Epoch);
+    if (epoch != FlagsReaderFree && epoch < oldest) {
+      oldest = epoch;
+    }
+  }
+
+  FlagsSnapshot **link = &reloader->Retired;
+  while (*link) {
+    FlagsSnapshot *snapshot = *link;
+    if (snapshot->RetiredAt <= oldest) {
+      *link = snapshot->Retired;
+      FlagsSnapshotFree(snapshot);
+    } else {
+      link = &snapshot->Retired;
+    }
+  }
+}
+
+void FlagsReloaderRelease(FlagsReloader *reloader) {
+  while (reloader->Retired) {
+    FlagsSnapshot *next = reloader->Retired->Retired;
+    FlagsSnapshotFree(reloader->Retired);
+    reloader->Retired = next;
+  }
+  FlagsSnapshotFree(
+      atomic_load_explicit(&reloader->Current, memory_order_relaxed));
+  atomic_store_explicit(&reloader->Current, NULL, memory_order_relaxed);
+  if (reloader->Inotify >= 0) {
+    close(reloader->Inotify);
+    reloader->Inotify = -1;
+  }
+  free(reloader->Defaults);
+  free(reloader->Changed);
+  free(reloader->Path);
+  free(reloader->Dir);
+  reloader->Defaults = NULL;
+  reloader->Changed = NULL;
+  reloader->Path = NULL;
+  reloader->Dir = NULL;
+}
@@ -0,0 +1,107 @@
+#ifndef FLAGS_RELOAD_H_
+#define FLAGS_RELOAD_H_
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "file.h"
+#include "flags.h"
+
+#define FlagsMaxReaders 64
+#define FlagsCacheLineSize 64
+
+// FlagsReaderSlot holds the epoch of one reader on a cache line of its own,
+// so that readers do not write to the lines of each other.
+typedef struct FlagsReaderSlot {
+  alignas(FlagsCacheLineSize) _Atomic(uint64_t) Epoch;
+} FlagsReaderSlot;
+
+// FlagsSnapshot is an immutable copy of the record parsed from a flags
+// file. Its Record stays valid for as long as a reader may still see it.
+typedef struct FlagsSnapshot {
+  struct FlagsSnapshot *Retired;
+  FlagFile *Files;
+  uint64_t Generation;
+  uint64_t RetiredAt;
+  void *Record;
+} FlagsSnapshot;
+
+typedef void(FlagsReloadFunc)(void *ctx, const FlagsSnapshot *snapshot,
+                              const size_t *changed, size_t changedLen);
+
+// FlagsReloader re-parses a flags file into a fresh snapshot whenever the
+// file changes and publishes it with a single atomic pointer swap. The
+// options of Flags must point inside the Size bytes at Proto, whose
+// contents at initialization are the defaults of every snapshot.
+//
+// Every reader thread must take one of FlagsMaxReaders slots with
+// FlagsReloaderJoin before reading. Between FlagsReloaderAcquire and
+// FlagsReloaderDone on its slot, a reader may use the record it acquired,
+// and acquiring again replaces it. Neither call blocks: an acquire costs two
+// acquire loads and a plain store to the slot, which has a cache line of its
+// own, and done a release store. The full fence this needs between the
+// store and the load of the snapshot is issued on the reclaiming side with
+// membarrier where Linux supports it, and by readers otherwise, which
+// Asymmetric records.
+//
+// Each replaced snapshot is tagged with the epoch at which it was retired,
+// and it is freed once every slot is done or has acquired at a later epoch,
+// at the next reload or FlagsReloaderReclaim. Reload, Poll and Reclaim must
+// be called from a single thread, and Release only once all readers are
+// done. Reloaders are cache line aligned, and must be allocated with
+// aligned_alloc when they are not declared.
+typedef struct FlagsReloader {
+  const Flags *Flags;
+  const void *Proto;
+  size_t Size;
+  void *Defaults;
+  char *Path;
+  char *Dir;
+  const char *Base;
+  _Atomic(FlagsSnapshot *) Current;
+  _Atomic(uint64_t) Epoch;
+  bool Asymmetric;
+  FlagsReaderSlot Readers[FlagsMaxReaders];
+  FlagsSnapshot *Retired;
+  size_t *Changed;
+  FlagsReloadFunc *OnReload;
+  void *Ctx;
+  int Inotify;
+} FlagsReloader;
+
+FlagError FlagsReloaderInit(FlagsReloader *reloader, const Flags *flags,
+                            const void *proto, size_t size, const char *path);
+void FlagsReloaderOnReload(FlagsReloader *reloader, FlagsReloadFunc *func,
+                           void *ctx);
+
+// FlagsReloaderJoin takes a free reader slot, failing with
+// FlagErrNoMemory when all FlagsMaxReaders are taken, and
+// FlagsReloaderLeave gives it back.
+FlagError FlagsReloaderJoin(FlagsReloader *reloader, size_t *reader);
+void FlagsReloaderLeave(FlagsReloader *reloader, size_t reader);
+
+// FlagsReloaderAcquire returns the record of the current snapshot and keeps
+// it alive until FlagsReloaderDone is called on the same slot.
+const void *FlagsReloaderAcquire(FlagsReloader *reloader, size_t reader);
+const FlagsSnapshot *FlagsReloaderSnapshot(FlagsReloader *reloader,
+                                           size_t reader);
+void FlagsReloaderDone(FlagsReloader *reloader, size_t reader);
+
+// FlagsReloaderReload parses the file now and publishes the result. When the
+// file fails to parse the current snapshot is kept.
+FlagError FlagsReloaderReload(FlagsReloader *reloader);
+
+// FlagsReloaderPoll waits up to timeoutMs milliseconds for the file to
+// change and reloads it when it does. It is meant to be called in a loop
+// from a thread off the hot path.
+FlagError FlagsReloaderPoll(FlagsReloader *reloader, int timeoutMs);
+
+// FlagsReloaderReclaim frees the replaced snapshots no reader can still
+// see. Reloads call it as well.
+void FlagsReloaderReclaim(FlagsReloader *reloader);
+void FlagsReloaderRelease(FlagsReloader *reloader);
+
+#endif // FLAGS_RELOAD_H_
@@ -0,0 +1,381 @@
+#include "flags.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lazy.h"
+
+static size_t FlagsSeenLen(const Flags *flags) {
+  return (flags->Options.OptionsLen + 63) / 64;
+}
+
+// FlagsSeenWords returns the options given in the session followed by
+// those given in the current input, each FlagsSeenLen words long, or NULL
+// when they were never allocated.
+static uint64_t *FlagsSeenWords(Flags *flags) {
+  FlagOptions *options = &flags->Options;
+  if (options->Seen) {
+    return options->Seen;
+  }
+  return options->OptionsLen <= 64 ? options->SeenWords : NULL;
+}
+
+FlagRule FlagNewConflict(const char *const *names) {
+  FlagRule rule = {.Kind = FlagRuleConflict, .Names = names};
+  return rule;
+}
+
+FlagRule FlagNewRequires(const char *const *names) {
+  FlagRule rule = {.Kind = FlagRuleRequires, .Names = names};
+  return rule;
+}
+
+FlagOption FlagsRequired(FlagOption option) {
+  option.Required = true;
+  return option;
+}
+
+FlagOption FlagsDuplicates(FlagOption option, FlagDuplicates policy) {
+  option.Duplicates = policy;
+  return option;
+}
+
+// FlagsMarkSeen records option in the session and input bits, which may
+// be the same words, following its duplicates policy within the input.
+static FlagError FlagsMarkSeen(const FlagOptions *options, uint64_t *session,
+                               uint64_t *input, const FlagOption *option,
+                               bool *apply, int *errorOption) {
+  const size_t pos = (size_t)(option - options->Options);
+  const uint64_t bit = (uint64_t)1 << (pos % 64);
+  *apply = true;
+  if (input[pos / 64] & bit) {
+    if (option->Duplicates == FlagDuplicatesError) {
+      *errorOption = (int)pos;
+      return FlagErrDuplicateFlag;
+    }
+    *apply = option->Duplicates == FlagDuplicatesLastWins;
+  }
+
+  session[pos / 64] |= bit;
+  input[pos / 64] |= bit;
+  return Ok;
+}
+
+FlagError FlagsSeeOption(Flags *flags, const FlagOption *option, bool *apply) {
+  uint64_t *seen = FlagsSeenWords(flags);
+  if (!seen) {
+    *apply = true;
+    return Ok;
+  }
+
+  const size_t words = FlagsSeenLen(flags);
+  const size_t pos = (size_t)(option - flags->Options.Options);
+  const uint64_t bit = (uint64_t)1 << (pos % 64);
+  if ((seen[pos / 64] & bit) && !(seen[words + pos / 64] & bit) &&
+      (option->Type == FlagInt64List || option->Type == FlagUint32List ||
+       option->Type == FlagStringViewList)) {
+    // a later input replaces the values of an earlier one instead of
+    // appending to them
+    ((FlagList *)option->Value)->Len = 0;
+  }
+
+  return FlagsMarkSeen(&flags->Options, seen, seen + words, option, apply,
+                       &flags->ErrorOption);
+}
+
+static size_t FlagsLowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_ctzll(bits);
+#else
+  size_t i = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+static void FlagsResolvePendingOption(FlagOption *option) {
+  // a value that does not convert is dropped, as FlagsValidate would have
+  // reported it in its session
+  FlagsResolve(option);
+  option->Pending = false;
+  option->Raw = (StringView){.Ptr = NULL, .Len = 0};
+}
+
+// FlagsResolvePending converts the values a lazy session left pending, as
+// the text they point to may not outlive it, so that a later session keeps
+// them like an eager parse would. Only the options given in the session are
+// visited when seen has their bits.
+static void FlagsResolvePending(Flags *flags, const uint64_t *seen) {
+  FlagOptions *options = &flags->Options;
+  if (!seen) {
+    for (size_t i = 0; i < options->OptionsLen; i++) {
+      if (options->Options[i].Pending) {
+        FlagsResolvePendingOption(&options->Options[i]);
+      }
+    }
+    return;
+  }
+
+  for (size_t w = 0; w < FlagsSeenLen(flags); w++) {
+    for (uint64_t bits = seen[w]; bits != 0; bits &= bits - 1) {
+      FlagOption *option = &options->Options[w * 64 + FlagsLowestBit(bits)];
+      if (option->Pending) {
+        FlagsResolvePendingOption(option);
+      }
+    }
+  }
+}
+
+void FlagsResetSeen(Flags *flags) {
+  flags->ErrorOption = -1;
+  flags->Finished = false;
+  uint64_t *seen = FlagsSeenWords(flags);
+  if (flags->Lazy) {
+    FlagsResolvePending(flags, seen);
+  }
+
+  if (seen) {
+    memset(seen, 0, 2 * FlagsSeenLen(flags) * sizeof(uint64_t));
+  }
+}
+
+FlagError FlagsBeginInput(Flags *flags) {
+  // the previous session is reset first, while its words are still there
+  if (flags->Finished) {
+    FlagsResetSeen(flags);
+  }
+
+  FlagOptions *options = &flags->Options;
+  if (!FlagsSeenWords(flags)) {
+    // flags that were not compiled only have room for 64 options inline
+    options->Seen = calloc(2 * FlagsSeenLen(flags), sizeof(uint64_t));
+    if (!options->Seen) {
+      return FlagErrNoMemory;
+    }
+  }
+
+  flags->ErrorOption = -1;
+  const size_t words = FlagsSeenLen(flags);
+  memset(FlagsSeenWords(flags) + words, 0, words * sizeof(uint64_t));
+  return Ok;
+}
+
+FlagError FlagsSeenInit(FlagsSeenSet *seen, const Flags *flags) {
+  const size_t words = FlagsSeenLen(flags);
+  seen->Words = seen->Stack;
+  if (words > sizeof(seen->Stack) / sizeof(seen->Stack[0])) {
+    seen->Words = malloc(words * sizeof(uint64_t));
+    if (!seen->Words) {
+      return FlagErrNoMemory;
+    }
+  }
+
+  memset(seen->Words, 0, words * sizeof(uint64_t));
+  return Ok;
+}
+
+void FlagsSeenRelease(FlagsSeenSet *seen) {
+  if (seen->Words != seen->Stack) {
+    free(seen->Words);
+  }
+  seen->Words = NULL;
+}
+
+FlagError FlagsSeenAdd(const Flags *flags, FlagsSeenSet *seen,
+                       const FlagOption *option, bool *apply) {
+  int errorOption = -1;
+  return FlagsMarkSeen(&flags->Options, seen->Words, seen->Words, option,
+                       apply, &errorOption);
+}
+
+// FlagsMasksLen is the number of words of the masks of flags: the
+// required options, then for every rule its options and its trigger.
+static size_t FlagsMasksLen(const Flags *flags) {
+  return (2 * flags->Rules.RulesLen + 1) * FlagsSeenLen(flags);
+}
+
+// FlagsBuildMasks fills masks with the bitmask of the required options
+// followed by two bitmasks for every rule, each words long. The trigger of
+// a requires rule is left out of the first one and is the second one.
+static FlagError FlagsBuildMasks(const Flags *flags, uint64_t *masks,
+                                 size_t words) {
+  const FlagOptions *options = &flags->Options;
+  memset(masks, 0, FlagsMasksLen(flags) * sizeof(uint64_t));
+  for (size_t i = 0; i < options->OptionsLen; i++) {
+    if (options->Options[i].Required) {
+      masks[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+  }
+
+  for (size_t r = 0; r < flags->Rules.RulesLen; r++) {
+    const FlagRule *rule = &flags->Rules.Rules[r];
+    uint64_t *mask = masks + (2 * r + 1) * words;
+    uint64_t *trigger = mask + words;
+    for (size_t n = 0; rule->Names[n]; n++) {
+      const char *name = rule->Names[n];
+      const FlagOption *option = FlagsLookupOption(flags, name, strlen(name));
+      if (!option) {
+        return FlagErrUnknownFlag;
+      }
+
+      const size_t pos = (size_t)(option - options->Options);
+      uint64_t *target =
+          n == 0 && rule->Kind == FlagRuleRequires ? trigger : mask;
+      target[pos / 64] |= (uint64_t)1 << (pos % 64);
+    }
+  }
+
+  return Ok;
+}
+
+FlagError FlagsCompileRules(Flags *flags) {
+  FlagOptions *options = &flags->Options;
+  const size_t words = FlagsSeenLen(flags);
+  if (options->OptionsLen > 64) {
+    options->Seen = calloc(2 * words, sizeof(uint64_t));
+    if (!options->Seen) {
+      return FlagErrNoMemory;
+    }
+  }
+
+  options->Masks = calloc(FlagsMasksLen(flags), sizeof(uint64_t));
+  if (!options->Masks) {
+    return FlagErrNoMemory;
+  }
+  return FlagsBuildMasks(flags, options->Masks, words);
+}
+
+void FlagsReleaseRules(Flags *flags) {
+  free(flags->Options.Seen);
+  free(flags->Options.Masks);
+  flags->Options.Seen = NULL;
+  flags->Options.Masks = NULL;
+}
+
+// FlagsFirstMissing returns the position of the first option in mask that
+// is not in seen, or -1 if they were all given.
+static int FlagsFirstMissing(const uint64_t *mask, const uint64_t *seen,
+                             size_t words) {
+  for (size_t w = 0; w < words; w++) {
+    const uint64_t missing = mask[w] & ~seen[w];
+    if (missing) {
+      return (int)(w * 64 + (size_t)__builtin_ctzll(missing));
+    }
+  }
+  return -1;
+}
+
+// FlagsSecondSeen returns the position of the second option in mask that
+// was given, or -1 if at most one was.
+static int FlagsSecondSeen(const uint64_t *mask, const uint64_t *seen,
+                           size_t words) {
+  bool found = false;
+  for (size_t w = 0; w < words; w++) {
+    uint64_t both = mask[w] & seen[w];
+    if (both && found) {
+      return (int)(w * 64 + (size_t)__builtin_ctzll(both));
+    }
+
+    if (both) {
+      found = true;
+      both &= both - 1;
+      if (both) {
+        return (int)(w * 64 + (size_t)__builtin_ctzll(both));
+      }
+    }
+  }
+  return -1;
+}
+
+static FlagError FlagsCheckMasks(const Flags *flags, const uint64_t *masks,
+                                 const uint64_t *seen, size_t words,
+                                 int *errorOption) {
+  int pos = FlagsFirstMissing(masks, seen, words);
+  if (pos >= 0) {
+    *errorOption = pos;
+    return FlagErrMissingFlag;
+  }
+
+  for (size_t r = 0; r < flags->Rules.RulesLen; r++) {
+    const FlagRule *rule = &flags->Rules.Rules[r];
+    const uint64_t *mask = masks + (2 * r + 1) * words;
+    if (rule->Kind == FlagRuleConflict) {
+      pos = FlagsSecondSeen(mask, seen, words);
+      if (pos >= 0) {
+        *errorOption = pos;
+        return FlagErrConflict;
+      }
+      continue;
+    }
+
+    // the trigger is given when it is not missing
+    if (FlagsFirstMissing(mask + words, seen, words) >= 0) {
+      continue;
+    }
+
+    pos = FlagsFirstMissing(mask, seen, words);
+    if (pos >= 0) {
+      *errorOption = pos;
+      return FlagErrMissingFlag;
+    }
+  }
+
+  return Ok;
+}
+
+// FlagsCheckSeen evaluates the required options and rules of flags against
+// seen, setting errorOption on failure.
+static FlagError FlagsCheckSeen(const Flags *flags, const uint64_t *seen,
+                                int *errorOption) {
+  const size_t words = FlagsSeenLen(flags);
+  if (flags->Options.Masks) {
+    return FlagsCheckMasks(flags, flags->Options.Masks, seen, words,
+                           errorOption);
+  }
+
+  // flags that were not compiled build their masks for every check
+  uint64_t stack[16];
+  const size_t len = FlagsMasksLen(flags);
+  uint64_t *masks = len <= 16 ? stack : malloc(len * sizeof(uint64_t));
+  if (!masks) {
+    return FlagErrNoMemory;
+  }
+
+  FlagError err = FlagsBuildMasks(flags, masks, words);
+  if (!err) {
+    err = FlagsCheckMasks(flags, masks, seen, words, errorOption);
+  }
+
+  if (masks != stack) {
+    free(masks);
+  }
+  return err;
+}
+
+FlagError FlagsCheck(Flags *flags) {
+  const uint64_t *seen = FlagsSeenWords(flags);
+  // nothing was given when no input was begun
+  const FlagError err =
+      seen ? FlagsCheckSeen(flags, seen, &flags->ErrorOption) : Ok;
+  FlagsEndSession(flags);
+  return err;
+}
+
+void FlagsEndSession(Flags *flags) {
+  flags->Finished = true;
+  FlagOptions *options = &flags->Options;
+  if (!options->Masks) {
+    // flags that were not compiled are never released, so the words
+    // FlagsBeginInput allocated for them only last one session
+    free(options->Seen);
+    options->Seen = NULL;
+  }
+}
+
+FlagError FlagsSeenCheck(const Flags *flags, const FlagsSeenSet *seen,
+                         int *errorOption) {
+  return FlagsCheckSeen(flags, seen->Words, errorOption);
+}
@@ -0,0 +1,166 @@
+#ifndef FLAGS_SCHEMA_H_
+#define FLAGS_SCHEMA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "flags.h"
+#include "parse.h"
+
+// A schema declares a set of options once, as an X-macro list, and expands
+// into a config struct, its defaults and a static const table, all built at
+// compile time, plus a parser that compares names against literals and
+// calls the typed Parse functions directly. Given the list below, with its
+// line continuations omitted,
+//
+//   #define SERVER_FLAGS(X, S)
+//     X(S, Int64, conns, "conns", "number of connections", 8)
+//     X(S, Bool, verbose, "verbose", "print more output", false)
+//     X(S, Duration, timeout, "timeout", "request timeout", 1000000000)
+//
+//   FlagsSchemaDeclare(ServerFlags, SERVER_FLAGS)
+//
+// declares the struct ServerFlags, the constant ServerFlagsDefaults, the
+// table ServerFlagsSchema of ServerFlagsSchemaLen entries and the function
+// ServerFlagsParse. Each entry names its type, which is one of Bool, Int32,
+// Int64, Uint32, Uint64, Float, Double, Duration, ByteSize and StringView,
+// followed by the struct field, the option name, its help and its default.
+typedef struct FlagsSchemaEntry {
+  HelpItem Help;
+  FlagType Type;
+  size_t Offset;
+} FlagsSchemaEntry;
+
+#define FlagsSchemaCTypeBool bool
+#define FlagsSchemaCTypeInt32 int32_t
+#define FlagsSchemaCTypeInt64 int64_t
+#define FlagsSchemaCTypeUint32 uint32_t
+#define FlagsSchemaCTypeUint64 uint64_t
+#define FlagsSchemaCTypeFloat float
+#define FlagsSchemaCTypeDouble double
+#define FlagsSchemaCTypeDuration int64_t
+#define FlagsSchemaCTypeByteSize uint64_t
+#define FlagsSchemaCTypeStringView StringView
+
+#define FlagsSchemaInitBool(value) value
+#define FlagsSchemaInitInt32(value) value
+#define FlagsSchemaInitInt64(value) value
+#define FlagsSchemaInitUint32(value) value
+#define FlagsSchemaInitUint64(value) value
+#define FlagsSchemaInitFloat(value) value
+#define FlagsSchemaInitDouble(value) value
+#define FlagsSchemaInitDuration(value) value
+#define FlagsSchemaInitByteSize(value) value
+#define FlagsSchemaInitStringView(value)                                       \
+  { .Ptr = value, .Len = sizeof(value) - 1 }
+
+// FlagsSchemaMatch compares s against a string literal. The length and first
+// byte are constants, so most mismatches are rejected without a call.
+#define FlagsSchemaMatch(s, len, lit)                                          \
+  ((len) == sizeof(lit) - 1 && (s)[0] == (lit)[0] &&                           \
+   memcmp((s), (lit), sizeof(lit) - 1) == 0)
+
+static inline FlagError FlagsSchemaApplyBool(bool *value, const FlagArg *arg,
+                                             int argc, char **argv,
+                                             int *consumed) {
+  (void)argc;
+  (void)argv;
+  *consumed = 0;
+  if (arg->Value) {
+    return ParseBool(value, arg->Value, arg->ValueLen) ? Ok : FlagErrParse;
+  }
+  *value = true;
+  return Ok;
+}
+
+#define FlagsSchemaDefineApply(type, ctype)                                    \
+  static inline FlagError FlagsSchemaApply##type(                              \
+      ctype *value, const FlagArg *arg, int argc, char **argv,                 \
+      int *consumed) {                                                         \
+    *consumed = 0;                                                             \
+    if (arg->Value) {                                                          \
+      return Parse##type(value, arg->Value, arg->ValueLen) ? Ok                \
+                                                           : FlagErrParse;     \
+    }                                                                          \
+    if (argc < 1) {                                                            \
+      return FlagErrNoArg;                                                     \
+    }                                                                          \
+    *consumed = 1;                                                             \
+    return Parse##type(value, argv[0], strlen(argv[0])) ? Ok : FlagErrParse;   \
+  }
+
+FlagsSchemaDefineApply(Int32, int32_t)
+FlagsSchemaDefineApply(Int64, int64_t)
+FlagsSchemaDefineApply(Uint32, uint32_t)
+FlagsSchemaDefineApply(Uint64, uint64_t)
+FlagsSchemaDefineApply(Float, float)
+FlagsSchemaDefineApply(Double, double)
+FlagsSchemaDefineApply(Duration, int64_t)
+FlagsSchemaDefineApply(ByteSize, uint64_t)
+FlagsSchemaDefineApply(StringView, StringView)
+
+#define FlagsSchemaField(S, type, field, name, help, value)                    \
+  FlagsSchemaCType##type field;
+
+#define FlagsSchemaDefault(S, type, field, name, help, value)                  \
+  .field = FlagsSchemaInit##type(value),
+
+#define FlagsSchemaEntryOf(S, type, field, name, help, value)                  \
+  {.Help = {.Name = name,                                                      \
+            .Help = help,                                                      \
+            .Group = NULL,                                                     \
+            .NameLen = sizeof(name) - 1},                                      \
+   .Type = Flag##type,                                                         \
+   .Offset = offsetof(S, field)},
+
+#define FlagsSchemaDispatch(S, type, field, name, help, value)                 \
+  if (FlagsSchemaMatch(arg->Name, arg->NameLen, name)) {                       \
+    return FlagsSchemaApply##type(&config->field, arg, argc, argv, consumed);  \
+  }
+
+// FlagsSchemaDeclare expands the schema list into its declarations. The
+// generated Parse function accepts -name, --name and values attached as in
+// --name=value, like FlagsParse but without short aliases, commands or
+// response files. It stops at the first argument that is not an option,
+// leaving it at index, or after --, and on error index is set to the
+// offending option.
+#define FlagsSchemaDeclare(S, list)                                            \
+  typedef struct S {                                                           \
+    list(FlagsSchemaField, S)                                                  \
+  } S;                                                                         \
+                                                                               \
+  static const S S##Defaults = {list(FlagsSchemaDefault, S)};                  \
+  static const FlagsSchemaEntry S##Schema[] = {list(FlagsSchemaEntryOf, S)};   \
+  enum { S##SchemaLen = sizeof(S##Schema) / sizeof(FlagsSchemaEntry) };        \
+                                                                               \
+  static inline FlagError S##ParseOption(S *config, const FlagArg *arg,        \
+                                         int argc, char **argv,                \
+                                         int *consumed) {                      \
+    list(FlagsSchemaDispatch, S) return FlagErrUnknownFlag;                    \
+  }                                                                            \
+                                                                               \
+  static inline FlagError S##Parse(S *config, int argc, char *argv[],          \
+                                   int *index) {                               \
+    int i = 1;                                                                 \
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {              \
+      if (argv[i][1] == '-' && argv[i][2] == '\0') {                           \
+        i++;                                                                   \
+        break;                                                                 \
+      }                                                                        \
+      int consumed = 0;                                                        \
+      const FlagArg arg = FlagsSplitArg(argv[i], strlen(argv[i]));             \
+      const FlagError err =                                                    \
+          S##ParseOption(config, &arg, argc - i - 1, argv + i + 1, &consumed); \
+      if (err) {                                                               \
+        *index = i;                                                            \
+        return err;                                                            \
+      }                                                                        \
+      i += 1 + consumed;                                                       \
+    }                                                                          \
+    *index = i;                                                                \
+    return Ok;                                                                 \
+  }
+
+#endif // FLAGS_SCHEMA_H_
@@ -0,0 +1,443 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "serialize.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cell.h"
+#include "lazy.h"
+#include "strings.h"
+
+static const uint8_t SerialMagic[4] = {'F', 'L', 'G', 'S'};
+
+// header: magic, version, schema hash and the length of the whole blob
+static const size_t SerialHeaderLen = 4 + 4 + 8 + 8;
+
+typedef struct SerialWriter {
+  uint8_t *Buf;
+  size_t Cap;
+  size_t Len;
+} SerialWriter;
+
+typedef struct SerialReader {
+  const uint8_t *Buf;
+  size_t Len;
+  size_t Pos;
+} SerialReader;
+
+static void SerialPut(SerialWriter *writer, const void *s, size_t len) {
+  if (len > 0 && writer->Len + len <= writer->Cap) {
+    memcpy(writer->Buf + writer->Len, s, len);
+  }
+  writer->Len += len;
+}
+
+static void SerialPutUint(SerialWriter *writer, uint64_t value, size_t width) {
+  uint8_t bytes[8];
+  for (size_t i = 0; i < width; i++) {
+    bytes[i] = (uint8_t)(value >> (8 * i));
+  }
+  SerialPut(writer, bytes, width);
+}
+
+static void SerialPutBytes(SerialWriter *writer, const void *s, size_t len) {
+  SerialPutUint(writer, len, 4);
+  SerialPut(writer, s, len);
+}
+
+static const uint8_t *SerialGet(SerialReader *reader, size_t len) {
+  if (len > reader->Len - reader->Pos) {
+    return NULL;
+  }
+
+  const uint8_t *ptr = reader->Buf + reader->Pos;
+  reader->Pos += len;
+  return ptr;
+}
+
+static bool SerialGetUint(SerialReader *reader, size_t width,
+                          uint64_t *value) {
+  const uint8_t *bytes = SerialGet(reader, width);
+  if (!bytes) {
+    return false;
+  }
+
+  uint64_t v = 0;
+  for (size_t i = 0; i < width; i++) {
+    v |= (uint64_t)bytes[i] << (8 * i);
+  }
+  *value = v;
+  return true;
+}
+
+static const char *SerialGetBytes(SerialReader *reader, size_t *len) {
+  uint64_t n;
+  if (!SerialGetUint(reader, 4, &n)) {
+    return NULL;
+  }
+
+  *len = (size_t)n;
+  return (const char *)SerialGet(reader, *len);
+}
+
+static size_t SerialCapacity(const FlagOption *option) {
+  switch (option->Type) {
+  case FlagString:
+    return option->MaxLen;
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList:
+    return ((const FlagList *)option->Value)->Cap;
+  case FlagAtomicString:
+    return ((const FlagCellString *)option->Value)->Cap;
+  default:
+    return 0;
+  }
+}
+
+uint64_t FlagsSchemaHash(const Flags *flags) {
+  uint64_t hash = StringHashOffset;
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    const FlagOption *option = &flags->Options.Options[i];
+    uint8_t desc[9];
+    const uint64_t cap = SerialCapacity(option);
+    desc[0] = (uint8_t)option->Type;
+    for (size_t b = 0; b < 8; b++) {
+      desc[b + 1] = (uint8_t)(cap >> (8 * b));
+    }
+
+    hash = StringHashAppend(hash, option->Help.Name,
+                            strlen(option->Help.Name) + 1);
+    hash = StringHashAppend(hash, (const char *)desc, sizeof(desc));
+    for (size_t c = 0; option->Type == FlagEnum && option->Choices[c]; c++) {
+      hash = StringHashAppend(hash, option->Choices[c],
+                              strlen(option->Choices[c]) + 1);
+    }
+  }
+  return hash;
+}
+
+static size_t SerialChoicesLen(const FlagOption *option) {
+  size_t len = 0;
+  while (option->Choices[len]) {
+    len++;
+  }
+  return len;
+}
+
+// SerialEnumValid accepts the index of a choice, or a negative value left
+// by a program for an enum that was not given, so that every value written
+// restores.
+static bool SerialEnumValid(const FlagOption *option, int choice) {
+  return choice < 0 || (size_t)choice < SerialChoicesLen(option);
+}
+
+static FlagError SerialWriteValue(SerialWriter *writer,
+                                  const FlagOption *option) {
+  const void *value = option->Value;
+  switch (option->Type) {
+  case FlagBool:
+    SerialPutUint(writer, *(const bool *)value, 1);
+    return Ok;
+  case FlagAtomicBool:
+    SerialPutUint(writer, atomic_load((const atomic_bool *)value), 1);
+    return Ok;
+  case FlagEnum: {
+    const int choice = *(const int *)value;
+    if (!SerialEnumValid(option, choice)) {
+      return FlagErrSchema;
+    }
+    SerialPutUint(writer, (uint32_t)choice, 4);
+    return Ok;
+  }
+  case FlagInt32:
+  case FlagUint32:
+  case FlagFloat: {
+    uint32_t bits;
+    memcpy(&bits, value, sizeof(bits));
+    SerialPutUint(writer, bits, 4);
+    return Ok;
+  }
+  case FlagInt64:
+  case FlagUint64:
+  case FlagDouble:
+  case FlagDuration:
+  case FlagByteSize: {
+    uint64_t bits;
+    memcpy(&bits, value, sizeof(bits));
+    SerialPutUint(writer, bits, 8);
+    return Ok;
+  }
+  case FlagAtomicInt32:
+  case FlagAtomicUint32:
+    SerialPutUint(writer, atomic_load((const _Atomic uint32_t *)value), 4);
+    return Ok;
+  case FlagAtomicInt64:
+  case FlagAtomicUint64:
+    SerialPutUint(writer, atomic_load((const _Atomic uint64_t *)value), 8);
+    return Ok;
+  case FlagString:
+    SerialPutBytes(writer, value, strnlen(value, option->MaxLen));
+    return Ok;
+  case FlagStringView: {
+    const StringView *view = value;
+    SerialPutBytes(writer, view->Ptr, view->Len);
+    return Ok;
+  }
+  case FlagAtomicString: {
+    FlagCellString *cell = option->Value;
+    if (cell->Cap == 0) {
+      SerialPutBytes(writer, NULL, 0);
+      return Ok;
+    }
+
+    char *scratch = malloc(cell->Cap);
+    if (!scratch) {
+      return FlagErrNoMemory;
+    }
+
+    SerialPutBytes(writer, scratch,
+                   FlagCellLoadString(cell, scratch, cell->Cap));
+    free(scratch);
+    return Ok;
+  }
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList: {
+    const FlagList *list = value;
+    // a list that overflowed only kept its first Cap elements
+    const size_t len = list->Len < list->Cap ? list->Len : list->Cap;
+    SerialPutUint(writer, len, 4);
+    for (size_t i = 0; i < len; i++) {
+      if (option->Type == FlagInt64List) {
+        SerialPutUint(writer, (uint64_t)((const int64_t *)list->Values)[i], 8);
+      } else if (option->Type == FlagUint32List) {
+        SerialPutUint(writer, ((const uint32_t *)list->Values)[i], 4);
+      } else {
+        const StringView *view = &((const StringView *)list->Values)[i];
+        SerialPutBytes(writer, view->Ptr, view->Len);
+      }
+    }
+    return Ok;
+  }
+  default:
+    abort();
+  }
+}
+
+FlagError FlagsSerialize(Flags *flags, void *buf, size_t cap, size_t *len) {
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagError err = FlagsResolve(&flags->Options.Options[i]);
+    if (err) {
+      return err;
+    }
+  }
+
+  SerialWriter writer = {.Buf = buf, .Cap = buf ? cap : 0, .Len = 0};
+  SerialPut(&writer, SerialMagic, sizeof(SerialMagic));
+  SerialPutUint(&writer, FlagsSerializeVersion, 4);
+  SerialPutUint(&writer, FlagsSchemaHash(flags), 8);
+  // the length is patched in once the values have been written
+  SerialPutUint(&writer, 0, 8);
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagError err = SerialWriteValue(&writer, &flags->Options.Options[i]);
+    if (err) {
+      return err;
+    }
+  }
+
+  *len = writer.Len;
+  if (writer.Len > writer.Cap) {
+    return FlagErrNoMemory;
+  }
+
+  SerialWriter header = {.Buf = buf, .Cap = cap, .Len = SerialHeaderLen - 8};
+  SerialPutUint(&header, writer.Len, 8);
+  return Ok;
+}
+
+// SerialReadValue reads the value of option, and only stores it through
+// option->Value when store is set, so that a blob can be validated whole
+// before any option changes.
+static bool SerialReadValue(SerialReader *reader, const FlagOption *option,
+                            bool store) {
+  void *value = option->Value;
+  uint64_t bits;
+  size_t len;
+  const char *s;
+  switch (option->Type) {
+  case FlagBool:
+    if (!SerialGetUint(reader, 1, &bits)) {
+      return false;
+    }
+    if (store) {
+      *(bool *)value = bits != 0;
+    }
+    return true;
+  case FlagAtomicBool:
+    if (!SerialGetUint(reader, 1, &bits)) {
+      return false;
+    }
+    if (store) {
+      atomic_store((atomic_bool *)value, bits != 0);
+    }
+    return true;
+  case FlagEnum:
+    if (!SerialGetUint(reader, 4, &bits) ||
+        !SerialEnumValid(option, (int)(uint32_t)bits)) {
+      return false;
+    }
+    if (store) {
+      *(int *)value = (int)(uint32_t)bits;
+    }
+    return true;
+  case FlagInt32:
+  case FlagUint32:
+  case FlagFloat: {
+    if (!SerialGetUint(reader, 4, &bits)) {
+      return false;
+    }
+    const uint32_t narrow = (uint32_t)bits;
+    if (store) {
+      memcpy(value, &narrow, sizeof(narrow));
+    }
+    return true;
+  }
+  case FlagInt64:
+  case FlagUint64:
+  case FlagDouble:
+  case FlagDuration:
+  case FlagByteSize:
+    if (!SerialGetUint(reader, 8, &bits)) {
+      return false;
+    }
+    if (store) {
+      memcpy(value, &bits, sizeof(bits));
+    }
+    return true;
+  case FlagAtomicInt32:
+  case FlagAtomicUint32:
+    if (!SerialGetUint(reader, 4, &bits)) {
+      return false;
+    }
+    if (store) {
+      atomic_store((_Atomic uint32_t *)value, (uint32_t)bits);
+    }
+    return true;
+  case FlagAtomicInt64:
+  case FlagAtomicUint64:
+    if (!SerialGetUint(reader, 8, &bits)) {
+      return false;
+    }
+    if (store) {
+      atomic_store((_Atomic uint64_t *)value, bits);
+    }
+    return true;
+  case FlagString:
+    s = SerialGetBytes(reader, &len);
+    if (!s || len >= option->MaxLen) {
+      return false;
+    }
+    if (store) {
+      memcpy(value, s, len);
+      ((char *)value)[len] = '\0';
+    }
+    return true;
+  case FlagStringView:
+    s = SerialGetBytes(reader, &len);
+    if (!s) {
+      return false;
+    }
+    if (store) {
+      ((StringView *)value)->Ptr = s;
+      ((StringView *)value)->Len = len;
+    }
+    return true;
+  case FlagAtomicString:
+    s = SerialGetBytes(reader, &len);
+    if (!s || len >= ((const FlagCellString *)value)->Cap) {
+      return false;
+    }
+    return !store || FlagCellStoreString(value, s, len);
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList: {
+    FlagList *list = value;
+    if (!SerialGetUint(reader, 4, &bits) || bits > list->Cap) {
+      return false;
+    }
+
+    for (size_t i = 0; i < (size_t)bits; i++) {
+      uint64_t elem;
+      if (option->Type == FlagInt64List) {
+        if (!SerialGetUint(reader, 8, &elem)) {
+          return false;
+        }
+        if (store) {
+          ((int64_t *)list->Values)[i] = (int64_t)elem;
+        }
+      } else if (option->Type == FlagUint32List) {
+        if (!SerialGetUint(reader, 4, &elem)) {
+          return false;
+        }
+        if (store) {
+          ((uint32_t *)list->Values)[i] = (uint32_t)elem;
+        }
+      } else {
+        s = SerialGetBytes(reader, &len);
+        if (!s) {
+          return false;
+        }
+        if (store) {
+          ((StringView *)list->Values)[i] =
+              (StringView){.Ptr = s, .Len = len};
+        }
+      }
+    }
+    if (store) {
+      list->Len = (size_t)bits;
+    }
+    return true;
+  }
+  default:
+    abort();
+  }
+}
+
+FlagError FlagsDeserialize(Flags *flags, const void *buf, size_t len) {
+  SerialReader reader = {.Buf = buf, .Len = len, .Pos = 0};
+  const uint8_t *magic = SerialGet(&reader, sizeof(SerialMagic));
+  uint64_t version;
+  uint64_t hash;
+  uint64_t blobLen;
+  if (!magic || memcmp(magic, SerialMagic, sizeof(SerialMagic)) != 0 ||
+      !SerialGetUint(&reader, 4, &version) ||
+      version != FlagsSerializeVersion || !SerialGetUint(&reader, 8, &hash) ||
+      hash != FlagsSchemaHash(flags) || !SerialGetUint(&reader, 8, &blobLen) ||
+      blobLen != len) {
+    return FlagErrSchema;
+  }
+
+  // the first pass only validates, so that a corrupt blob leaves every
+  // option as it was
+  const size_t values = reader.Pos;
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    if (!SerialReadValue(&reader, &flags->Options.Options[i], false)) {
+      return FlagErrSchema;
+    }
+  }
+  if (reader.Pos != len) {
+    return FlagErrSchema;
+  }
+
+  reader.Pos = values;
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagOption *option = &flags->Options.Options[i];
+    SerialReadValue(&reader, option, true);
+    option->Pending = false;
+  }
+  return Ok;
+}
@@ -0,0 +1,36 @@
+#ifndef FLAGS_SERIALIZE_H_
+#define FLAGS_SERIALIZE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+// FlagsSerializeVersion is bumped whenever the layout of a blob changes.
+#define FlagsSerializeVersion 1
+
+// FlagsSchemaHash hashes the name, type and capacity of every option, and
+// the choices of enums, so that a blob is only restored into options
+// declared the same way as those that wrote it.
+uint64_t FlagsSchemaHash(const Flags *flags);
+
+// FlagsSerialize writes the current value of every option into buf. A blob
+// starts with a magic, the version, the schema hash and the length of the
+// blob, followed by the values in option order as little endian fixed width
+// integers, with strings and lists prefixed by their 32 bit length. Pending
+// lazy options are resolved first. len is always set to the size of the
+// blob, and FlagErrNoMemory is returned when it is larger than cap, so that
+// buf may be NULL to size it. An enum holding neither the index of a choice
+// nor a negative value, which stands for no choice, fails with
+// FlagErrSchema.
+FlagError FlagsSerialize(Flags *flags, void *buf, size_t cap, size_t *len);
+
+// FlagsDeserialize stores the values of a blob written by FlagsSerialize
+// through the Value of each option, without parsing any text. The whole
+// blob is validated first: blobs of another version, schema or length, and
+// values that do not fit their option, such as an enum index past its
+// choices, are rejected with FlagErrSchema before any value is stored.
+// String views restored by it point into buf, which must outlive them.
+FlagError FlagsDeserialize(Flags *flags, const void *buf, size_t len);
+
+#endif // FLAGS_SERIALIZE_H_
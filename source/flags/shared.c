@@ -0,0 +1,481 @@
+#define _GNU_SOURCE
+
+#include "shared.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cell.h"
+#include "lazy.h"
+#include "serialize.h"
+
+static const char SharedMagic[4] = {'F', 'L', 'G', 'M'};
+
+// SharedWriter lays a region out at Base, or only measures it when Base is
+// NULL. Heap is the offset of the next free byte and stays 8 byte aligned
+// so that lists can be read in place.
+typedef struct SharedWriter {
+  uint8_t *Base;
+  size_t Heap;
+} SharedWriter;
+
+static size_t SharedAlign(size_t n) { return (n + 7) & ~(size_t)7; }
+
+static uint64_t SharedReserve(SharedWriter *writer, size_t len) {
+  const size_t offset = writer->Heap;
+  writer->Heap = SharedAlign(offset + len);
+  return offset;
+}
+
+static uint64_t SharedPutString(SharedWriter *writer, const char *s,
+                                size_t len) {
+  const uint64_t offset = SharedReserve(writer, len + 1);
+  if (writer->Base) {
+    if (len > 0) {
+      memcpy(writer->Base + offset, s, len);
+    }
+    writer->Base[offset + len] = '\0';
+  }
+  return offset;
+}
+
+static uint64_t SharedBits(const void *value, size_t size) {
+  uint64_t bits = 0;
+  if (size == sizeof(uint32_t)) {
+    uint32_t narrow;
+    memcpy(&narrow, value, sizeof(narrow));
+    bits = narrow;
+  } else {
+    memcpy(&bits, value, sizeof(bits));
+  }
+  return bits;
+}
+
+static void SharedPutList(SharedWriter *writer, const FlagOption *option,
+                          FlagsSharedEntry *entry) {
+  const FlagList *list = option->Value;
+  // a list that overflowed only kept its first Cap elements
+  const size_t len = list->Len < list->Cap ? list->Len : list->Cap;
+  entry->Len = (uint32_t)len;
+  if (option->Type == FlagInt64List) {
+    entry->Value = SharedReserve(writer, len * sizeof(int64_t));
+    if (writer->Base && len > 0) {
+      memcpy(writer->Base + entry->Value, list->Values, len * sizeof(int64_t));
+    }
+    return;
+  }
+
+  if (option->Type == FlagUint32List) {
+    entry->Value = SharedReserve(writer, len * sizeof(uint32_t));
+    if (writer->Base && len > 0) {
+      memcpy(writer->Base + entry->Value, list->Values,
+             len * sizeof(uint32_t));
+    }
+    return;
+  }
+
+  entry->Value = SharedReserve(writer, len * 2 * sizeof(uint64_t));
+  for (size_t i = 0; i < len; i++) {
+    const StringView *view = &((const StringView *)list->Values)[i];
+    const uint64_t pair[2] = {SharedPutString(writer, view->Ptr, view->Len),
+                              view->Len};
+    if (writer->Base) {
+      memcpy(writer->Base + entry->Value + i * sizeof(pair), pair,
+             sizeof(pair));
+    }
+  }
+}
+
+static void SharedPutValue(SharedWriter *writer, const FlagOption *option,
+                           FlagsSharedEntry *entry) {
+  const void *value = option->Value;
+  entry->Type = option->Type;
+  entry->Len = 0;
+  entry->Value = 0;
+  switch (option->Type) {
+  case FlagBool:
+    entry->Value = *(const bool *)value;
+    return;
+  case FlagAtomicBool:
+    entry->Type = FlagBool;
+    entry->Value = atomic_load((const atomic_bool *)value);
+    return;
+  case FlagEnum: {
+    const int choice = *(const int *)value;
+    entry->Value = (uint32_t)choice;
+    return;
+  }
+  case FlagInt32:
+  case FlagUint32:
+  case FlagFloat:
+    entry->Value = SharedBits(value, sizeof(uint32_t));
+    return;
+  case FlagInt64:
+  case FlagUint64:
+  case FlagDouble:
+  case FlagDuration:
+  case FlagByteSize:
+    entry->Value = SharedBits(value, sizeof(uint64_t));
+    return;
+  case FlagAtomicInt32:
+  case FlagAtomicUint32:
+    entry->Type = option->Type == FlagAtomicInt32 ? FlagInt32 : FlagUint32;
+    entry->Value = atomic_load((const _Atomic uint32_t *)value);
+    return;
+  case FlagAtomicInt64:
+  case FlagAtomicUint64:
+    entry->Type = option->Type == FlagAtomicInt64 ? FlagInt64 : FlagUint64;
+    entry->Value = atomic_load((const _Atomic uint64_t *)value);
+    return;
+  case FlagString: {
+    const size_t len = strnlen(value, option->MaxLen);
+    entry->Len = (uint32_t)len;
+    entry->Value = SharedPutString(writer, value, len);
+    return;
+  }
+  case FlagStringView: {
+    const StringView *view = value;
+    entry->Type = FlagString;
+    entry->Len = (uint32_t)view->Len;
+    entry->Value = SharedPutString(writer, view->Ptr, view->Len);
+    return;
+  }
+  case FlagAtomicString: {
+    // the cell may change between measuring and writing, so its whole
+    // capacity is reserved
+    FlagCellString *cell = option->Value;
+    entry->Type = FlagString;
+    entry->Len = 0;
+    if (cell->Cap == 0) {
+      entry->Value = SharedPutString(writer, "", 0);
+      return;
+    }
+
+    entry->Value = SharedReserve(writer, cell->Cap);
+    if (writer->Base) {
+      char *out = (char *)writer->Base + entry->Value;
+      const size_t len = FlagCellLoadString(cell, out, cell->Cap);
+      entry->Len = (uint32_t)(len < cell->Cap ? len : cell->Cap - 1);
+    }
+    return;
+  }
+  case FlagInt64List:
+  case FlagUint32List:
+  case FlagStringViewList:
+    SharedPutList(writer, option, entry);
+    return;
+  default:
+    abort();
+  }
+}
+
+static size_t SharedLayout(const Flags *flags, uint8_t *base) {
+  const size_t len = flags->Options.OptionsLen;
+  SharedWriter writer = {.Base = base, .Heap = 0};
+  SharedReserve(&writer, sizeof(FlagsSharedHeader));
+  FlagsSharedEntry *entries =
+      (FlagsSharedEntry *)(base ? base + writer.Heap : NULL);
+  SharedReserve(&writer, len * sizeof(FlagsSharedEntry));
+
+  for (size_t i = 0; i < len; i++) {
+    FlagsSharedEntry entry;
+    SharedPutValue(&writer, &flags->Options.Options[i], &entry);
+    if (entries) {
+      entries[i] = entry;
+    }
+  }
+
+  if (base) {
+    FlagsSharedHeader *header = (FlagsSharedHeader *)base;
+    memcpy(header->Magic, SharedMagic, sizeof(SharedMagic));
+    header->Version = FlagsSharedVersion;
+    header->Schema = FlagsSchemaHash(flags);
+    header->Len = writer.Heap;
+    header->EntriesLen = (uint32_t)len;
+    header->Reserved = 0;
+  }
+  return writer.Heap;
+}
+
+FlagError FlagsSharedPublish(Flags *flags, int *fd) {
+  for (size_t i = 0; i < flags->Options.OptionsLen; i++) {
+    FlagError err = FlagsResolve(&flags->Options.Options[i]);
+    if (err) {
+      return err;
+    }
+  }
+
+  const size_t len = SharedLayout(flags, NULL);
+  const int memfd = memfd_create("flags", MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    return FlagErrShared;
+  }
+
+  if (ftruncate(memfd, (off_t)len)) {
+    close(memfd);
+    return FlagErrShared;
+  }
+
+  uint8_t *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (base == MAP_FAILED) {
+    close(memfd);
+    return FlagErrShared;
+  }
+
+  SharedLayout(flags, base);
+  munmap(base, len);
+
+  // sealing guarantees readers that the region can no longer change
+  if (fcntl(memfd, F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)) {
+    close(memfd);
+    return FlagErrShared;
+  }
+
+  *fd = memfd;
+  return Ok;
+}
+
+FlagError FlagsSharedOpen(FlagsShared *shared, int fd, const Flags *flags) {
+  // without the seals the publisher, or anyone holding the descriptor,
+  // could resize or rewrite the region under the readers
+  const int required = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+  const int seals = fcntl(fd, F_GET_SEALS);
+  if (seals < 0 || (seals & required) != required) {
+    return FlagErrSchema;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) || (size_t)st.st_size < sizeof(FlagsSharedHeader)) {
+    return FlagErrSchema;
+  }
+
+  const size_t len = (size_t)st.st_size;
+  const uint8_t *base = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    return FlagErrShared;
+  }
+
+  const FlagsSharedHeader *header = (const FlagsSharedHeader *)base;
+  const size_t entriesLen = header->EntriesLen;
+  if (memcmp(header->Magic, SharedMagic, sizeof(SharedMagic)) != 0 ||
+      header->Version != FlagsSharedVersion || header->Len != len ||
+      entriesLen > (len - sizeof(FlagsSharedHeader)) /
+                       sizeof(FlagsSharedEntry) ||
+      (flags && (header->Schema != FlagsSchemaHash(flags) ||
+                 entriesLen != flags->Options.OptionsLen))) {
+    munmap((void *)base, len);
+    return FlagErrSchema;
+  }
+
+  shared->Base = base;
+  shared->Len = len;
+  shared->Header = header;
+  shared->Entries = (const FlagsSharedEntry *)(base + sizeof(*header));
+  return Ok;
+}
+
+void FlagsSharedClose(FlagsShared *shared) {
+  if (shared->Base) {
+    munmap((void *)shared->Base, shared->Len);
+  }
+  shared->Base = NULL;
+  shared->Len = 0;
+  shared->Header = NULL;
+  shared->Entries = NULL;
+}
+
+static FlagError SharedEntry(const FlagsShared *shared, size_t index,
+                             FlagType type, const FlagsSharedEntry **entry) {
+  if (index >= shared->Header->EntriesLen) {
+    return FlagErrUnknownFlag;
+  }
+
+  *entry = &shared->Entries[index];
+  return (*entry)->Type == (uint32_t)type ? Ok : FlagErrType;
+}
+
+// SharedData returns the data of entry, which spans size bytes, or NULL if
+// it does not lie within the region.
+static const uint8_t *SharedData(const FlagsShared *shared,
+                                 const FlagsSharedEntry *entry, size_t size) {
+  if (entry->Value > shared->Len || size > shared->Len - entry->Value) {
+    return NULL;
+  }
+  return shared->Base + entry->Value;
+}
+
+static FlagError SharedGetScalar(const FlagsShared *shared, size_t index,
+                                 FlagType type, void *value, size_t size) {
+  const FlagsSharedEntry *entry;
+  FlagError err = SharedEntry(shared, index, type, &entry);
+  if (err) {
+    return err;
+  }
+
+  if (size == sizeof(uint32_t)) {
+    const uint32_t narrow = (uint32_t)entry->Value;
+    memcpy(value, &narrow, sizeof(narrow));
+  } else {
+    memcpy(value, &entry->Value, sizeof(entry->Value));
+  }
+  return Ok;
+}
+
+FlagError FlagsSharedGetBool(const FlagsShared *shared, size_t index,
+                             bool *value) {
+  const FlagsSharedEntry *entry;
+  FlagError err = SharedEntry(shared, index, FlagBool, &entry);
+  if (!err) {
+    *value = entry->Value != 0;
+  }
+  return err;
+}
+
+FlagError FlagsSharedGetInt32(const FlagsShared *shared, size_t index,
+                              int32_t *value) {
+  return SharedGetScalar(shared, index, FlagInt32, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetInt64(const FlagsShared *shared, size_t index,
+                              int64_t *value) {
+  return SharedGetScalar(shared, index, FlagInt64, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetUint32(const FlagsShared *shared, size_t index,
+                               uint32_t *value) {
+  return SharedGetScalar(shared, index, FlagUint32, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetUint64(const FlagsShared *shared, size_t index,
+                               uint64_t *value) {
+  return SharedGetScalar(shared, index, FlagUint64, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetFloat(const FlagsShared *shared, size_t index,
+                              float *value) {
+  return SharedGetScalar(shared, index, FlagFloat, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetDouble(const FlagsShared *shared, size_t index,
+                               double *value) {
+  return SharedGetScalar(shared, index, FlagDouble, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetDuration(const FlagsShared *shared, size_t index,
+                                 int64_t *value) {
+  return SharedGetScalar(shared, index, FlagDuration, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetByteSize(const FlagsShared *shared, size_t index,
+                                 uint64_t *value) {
+  return SharedGetScalar(shared, index, FlagByteSize, value, sizeof(*value));
+}
+
+FlagError FlagsSharedGetEnum(const FlagsShared *shared, size_t index,
+                             int *value) {
+  const FlagsSharedEntry *entry;
+  FlagError err = SharedEntry(shared, index, FlagEnum, &entry);
+  if (!err) {
+    *value = (int)(uint32_t)entry->Value;
+  }
+  return err;
+}
+
+FlagError FlagsSharedGetString(const FlagsShared *shared, size_t index,
+                               StringView *value) {
+  const FlagsSharedEntry *entry;
+  FlagError err = SharedEntry(shared, index, FlagString, &entry);
+  if (err) {
+    return err;
+  }
+
+  const uint8_t *data = SharedData(shared, entry, (size_t)entry->Len + 1);
+  if (!data) {
+    return FlagErrSchema;
+  }
+
+  value->Ptr = (const char *)data;
+  value->Len = entry->Len;
+  return Ok;
+}
+
+static FlagError SharedGetList(const FlagsShared *shared, size_t index,
+                               FlagType type, size_t size, const void **values,
+                               size_t *len) {
+  const FlagsSharedEntry *entry;
+  FlagError err = SharedEntry(shared, index, type, &entry);
+  if (err) {
+    return err;
+  }
+
+  const uint8_t *data = SharedData(shared, entry, (size_t)entry->Len * size);
+  if (!data) {
+    return FlagErrSchema;
+  }
+
+  *values = data;
+  *len = entry->Len;
+  return Ok;
+}
+
+FlagError FlagsSharedGetInt64List(const FlagsShared *shared, size_t index,
+                                  const int64_t **values, size_t *len) {
+  const void *data;
+  FlagError err = SharedGetList(shared, index, FlagInt64List, sizeof(int64_t),
+                                &data, len);
+  if (!err) {
+    *values = data;
+  }
+  return err;
+}
+
+FlagError FlagsSharedGetUint32List(const FlagsShared *shared, size_t index,
+                                   const uint32_t **values, size_t *len) {
+  const void *data;
+  FlagError err = SharedGetList(shared, index, FlagUint32List,
+                                sizeof(uint32_t), &data, len);
+  if (!err) {
+    *values = data;
+  }
+  return err;
+}
+
+FlagError FlagsSharedGetStringViewList(const FlagsShared *shared, size_t index,
+                                       size_t *len) {
+  const void *data;
+  return SharedGetList(shared, index, FlagStringViewList,
+                       2 * sizeof(uint64_t), &data, len);
+}
+
+FlagError FlagsSharedGetListString(const FlagsShared *shared, size_t index,
+                                   size_t pos, StringView *value) {
+  const void *data;
+  size_t len;
+  FlagError err = SharedGetList(shared, index, FlagStringViewList,
+                                2 * sizeof(uint64_t), &data, &len);
+  if (err) {
+    return err;
+  }
+
+  if (pos >= len) {
+    return FlagErrUnknownFlag;
+  }
+
+  uint64_t pair[2];
+  memcpy(pair, (const uint8_t *)data + pos * sizeof(pair), sizeof(pair));
+  const FlagsSharedEntry view = {.Type = 0, .Len = 0, .Value = pair[0]};
+  const uint8_t *s = SharedData(shared, &view, (size_t)pair[1] + 1);
+  if (!s) {
+    return FlagErrSchema;
+  }
+
+  value->Ptr = (const char *)s;
+  value->Len = (size_t)pair[1];
+  return Ok;
+}
@@ -0,0 +1,95 @@
+#ifndef FLAGS_SHARED_H_
+#define FLAGS_SHARED_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+#define FlagsSharedVersion 1
+
+// FlagsSharedHeader starts a shared region. It is followed by one
+// FlagsSharedEntry per option, in option order, and then by the heap that
+// holds strings and lists. The region is laid out in the byte order of the
+// host, since it is only shared between processes on the same machine.
+typedef struct FlagsSharedHeader {
+  char Magic[4];
+  uint32_t Version;
+  uint64_t Schema;
+  uint64_t Len;
+  uint32_t EntriesLen;
+  uint32_t Reserved;
+} FlagsSharedHeader;
+
+// FlagsSharedEntry holds the bits of a scalar value in Value. For strings
+// and lists Value is the offset of the data within the region and Len the
+// number of bytes or elements. Strings are NUL terminated, lists of string
+// views are stored as pairs of offset and length.
+typedef struct FlagsSharedEntry {
+  uint32_t Type;
+  uint32_t Len;
+  uint64_t Value;
+} FlagsSharedEntry;
+
+// FlagsShared is a read only mapping of a region published by
+// FlagsSharedPublish.
+typedef struct FlagsShared {
+  const uint8_t *Base;
+  size_t Len;
+  const FlagsSharedHeader *Header;
+  const FlagsSharedEntry *Entries;
+} FlagsShared;
+
+// FlagsSharedPublish lays the current values of flags out in a sealed
+// memfd region and returns its descriptor in fd. Pending lazy options are
+// resolved first and cells are published with their current value. The
+// descriptor is inherited across fork and exec, so that workers can map it
+// with FlagsSharedOpen instead of parsing their arguments again.
+FlagError FlagsSharedPublish(Flags *flags, int *fd);
+
+// FlagsSharedOpen maps the region of fd read only and checks its header,
+// returning FlagErrSchema for a region it does not understand or that is
+// not sealed against shrinking, growing and writing. When flags
+// is not NULL the region must also have been published for options
+// declared the same way, as checked by FlagsSchemaHash.
+FlagError FlagsSharedOpen(FlagsShared *shared, int fd, const Flags *flags);
+void FlagsSharedClose(FlagsShared *shared);
+
+// The accessors read the value of the option at index without copying it.
+// They return FlagErrUnknownFlag for an index past the last option and
+// FlagErrType when the option has another type. Cells are read with the
+// accessor of their plain type, and strings and string views are both read
+// with FlagsSharedGetString.
+FlagError FlagsSharedGetBool(const FlagsShared *shared, size_t index,
+                             bool *value);
+FlagError FlagsSharedGetInt32(const FlagsShared *shared, size_t index,
+                              int32_t *value);
+FlagError FlagsSharedGetInt64(const FlagsShared *shared, size_t index,
+                              int64_t *value);
+FlagError FlagsSharedGetUint32(const FlagsShared *shared, size_t index,
+                               uint32_t *value);
+FlagError FlagsSharedGetUint64(const FlagsShared *shared, size_t index,
+                               uint64_t *value);
+FlagError FlagsSharedGetFloat(const FlagsShared *shared, size_t index,
+                              float *value);
+FlagError FlagsSharedGetDouble(const FlagsShared *shared, size_t index,
+                               double *value);
+FlagError FlagsSharedGetDuration(const FlagsShared *shared, size_t index,
+                                 int64_t *value);
+FlagError FlagsSharedGetByteSize(const FlagsShared *shared, size_t index,
+                                 uint64_t *value);
+FlagError FlagsSharedGetEnum(const FlagsShared *shared, size_t index,
+                             int *value);
+FlagError FlagsSharedGetString(const FlagsShared *shared, size_t index,
+                               StringView *value);
+FlagError FlagsSharedGetInt64List(const FlagsShared *shared, size_t index,
+                                  const int64_t **values, size_t *len);
+FlagError FlagsSharedGetUint32List(const FlagsShared *shared, size_t index,
+                                   const uint32_t **values, size_t *len);
+FlagError FlagsSharedGetStringViewList(const FlagsShared *shared, size_t index,
+                                       size_t *len);
+FlagError FlagsSharedGetListString(const FlagsShared *shared, size_t index,
+                                   size_t pos, StringView *value);
+
+#endif // FLAGS_SHARED_H_
@@ -0,0 +1,60 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "file.h"
+
+uint64_t FlagsStatsNow(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+    return 0;
+  }
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void FlagsStatsRecord(FlagsStats *stats, const FlagOption *option,
+                      uint64_t start, uint64_t split, uint64_t found) {
+  if (!stats) {
+    return;
+  }
+
+  const uint64_t end = FlagsStatsNow();
+  stats->TokenizeNs += split - start;
+  stats->LookupNs += found - split;
+  stats->ConvertNs += end - found;
+  if (option && (!stats->Slowest || end - split > stats->SlowestNs)) {
+    stats->Slowest = option;
+    stats->SlowestNs = end - split;
+  }
+}
+
+size_t FlagsStatsFormat(char *buf, size_t cap, const FlagsStats *stats) {
+  const char *slowest = stats->Slowest ? stats->Slowest->Help.Name : "-";
+  const int n = snprintf(
+      buf, cap,
+      "flags_stats tokens=%" PRIu64 " probes=%" PRIu64 " compares=%" PRIu64
+      " bytes_copied=%" PRIu64 " tokenize_ns=%" PRIu64 " lookup_ns=%" PRIu64
+      " convert_ns=%" PRIu64 " slowest=%s slowest_ns=%" PRIu64 "\n",
+      stats->Tokens, stats->Probes, stats->Compares, stats->BytesCopied,
+      stats->TokenizeNs, stats->LookupNs, stats->ConvertNs, slowest,
+      stats->SlowestNs);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+FlagError FlagsStatsWrite(int fd, const FlagsStats *stats) {
+  const size_t len = FlagsStatsFormat(NULL, 0, stats);
+  char *buf = malloc(len + 1);
+  if (!buf) {
+    return FlagErrNoMemory;
+  }
+
+  FlagsStatsFormat(buf, len + 1, stats);
+  const FlagError err = FlagsWriteAll(fd, buf, len);
+  free(buf);
+  return err;
+}
@@ -0,0 +1,59 @@
+#ifndef FLAGS_STATS_H_
+#define FLAGS_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+// FlagsStats accumulates what FlagsParse spent its time on. It is filled
+// through Flags.Stats only when the library is built with
+// FLAGS_ENABLE_STATS, otherwise the instrumentation is compiled out and the
+// counters stay as they were. Timings are in nanoseconds of the monotonic
+// clock: Tokenize covers measuring and splitting each token, Lookup the
+// search for its option and Convert the parsing of its value.
+typedef struct FlagsStats {
+  uint64_t Tokens;
+  uint64_t Probes;
+  uint64_t Compares;
+  uint64_t BytesCopied;
+  uint64_t TokenizeNs;
+  uint64_t LookupNs;
+  uint64_t ConvertNs;
+  uint64_t SlowestNs;
+  const FlagOption *Slowest;
+} FlagsStats;
+
+#ifdef FLAGS_ENABLE_STATS
+#define FlagsStatsAdd(stats, field, n)                                         \
+  do {                                                                         \
+    if (stats) {                                                               \
+      (stats)->field += (n);                                                   \
+    }                                                                          \
+  } while (0)
+#define FlagsStatsClock(var) const uint64_t var = FlagsStatsNow()
+#define FlagsStatsObserve(stats, option, start, split, found)                  \
+  FlagsStatsRecord(stats, option, start, split, found)
+#else
+#define FlagsStatsAdd(stats, field, n) ((void)0)
+#define FlagsStatsClock(var) ((void)0)
+#define FlagsStatsObserve(stats, option, start, split, found) ((void)0)
+#endif
+
+// FlagsStatsNow returns the monotonic clock in nanoseconds.
+uint64_t FlagsStatsNow(void);
+
+// FlagsStatsRecord charges the phases of one token that started at start,
+// was split at split and whose option was found at found, and keeps option
+// as the slowest one if its lookup and conversion took the longest so far.
+void FlagsStatsRecord(FlagsStats *stats, const FlagOption *option,
+                      uint64_t start, uint64_t split, uint64_t found);
+
+// FlagsStatsFormat renders stats as a single line of space separated
+// key=value pairs, starting with "flags_stats", into buf like snprintf.
+size_t FlagsStatsFormat(char *buf, size_t cap, const FlagsStats *stats);
+
+// FlagsStatsWrite renders stats and writes the line to fd at once.
+FlagError FlagsStatsWrite(int fd, const FlagsStats *stats);
+
+#endif // FLAGS_STATS_H_
@@ -2,10 +2,22 @@
 
 #include <ctype.h>
 #include <errno.h>
-#include <limits.h>
 #include <string.h>
 #include <strings.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const uint8_t CharClassTable[256] = {
+    ['\t'] = CharClassBlank,
+    ['\n'] = CharClassBlank | CharClassNewline,
+    ['\v'] = CharClassBlank,
+    ['\f'] = CharClassBlank,
+    ['\r'] = CharClassBlank,
+    [' '] = CharClassBlank,
+};
+
 bool StringCaseEqualsWithLen(const char *a, size_t alen, const char *b,
                              size_t blen) {
   return alen == blen && strncasecmp(a, b, alen) == 0;
@@ -52,9 +64,13 @@ bool CharIsNewline(char c) { return c == '\n'; }
 
 bool CharIsNotNewline(char c) { return c != '\n'; }
 
-bool CharIsBlank(char c) { return isspace(c); }
+bool CharIsBlank(char c) { return CharIsClass(c, CharClassBlank); }
 
-bool CharIsNotBlank(char c) { return !isspace(c); }
+bool CharIsNotBlank(char c) { return !CharIsClass(c, CharClassBlank); }
+
+bool CharIsClass(char c, CharClass classes) {
+  return (CharClassTable[(unsigned char)c] & classes) != 0;
+}
 
 bool StringIsEmpty(const char *c) { return c == NULL || *c == '\0'; }
 
@@ -94,18 +110,6 @@ const char *StringSkipChar(const char *c, size_t len, CharSkipper skipper) {
   return c;
 }
 
-const char *StringSkipLine(const char *c, size_t len) {
-  return StringSkipChar(c, len, CharIsNotNewline);
-}
-
-const char *StringSkipBlank(const char *c, size_t len) {
-  return StringSkipChar(c, len, CharIsBlank);
-}
-
-const char *StringSkipNonBlank(const char *c, size_t len) {
-  return StringSkipChar(c, len, CharIsNotBlank);
-}
-
 bool StringIsSubstringOf(const char *a, size_t alen, const char *s,
                          size_t slen) {
   if (alen == 0) {
@@ -141,8 +145,620 @@ bool StringIsSubstringOf(const char *a, size_t alen, const char *s,
   return match;
 }
 
+uint64_t StringHash(const char *s, size_t len) {
+  return StringHashAppend(StringHashOffset, s, len);
+}
+
+uint64_t StringHashAppend(uint64_t hash, const char *s, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)s[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static char CharFold(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : c;
+}
+
+uint64_t StringHashFolded(const char *s, size_t len) {
+  uint64_t hash = StringHashOffset;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)CharFold(s[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool StringFoldEqualsWithLen(const char *a, size_t alen, const char *b,
+                             size_t blen) {
+  if (alen != blen) {
+    return false;
+  }
+
+  for (size_t i = 0; i < alen; i++) {
+    if (CharFold(a[i]) != CharFold(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool CharIsSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static bool CharIsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static uint64_t StringLoadEight(const char *s) {
+  uint64_t v;
+  memcpy(&v, s, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static bool StringIsEightDigits(uint64_t v) {
+  // every byte must be in 0x30..0x39: the high nibble is 3 and adding 6 to
+  // the low nibble must not carry into the high nibble
+  return ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+
+static uint32_t StringParseEightDigits(uint64_t v) {
+  // combine adjacent digits pairwise: 1 digit to 2, 2 to 4, 4 to 8
+  const uint64_t mask = 0x000000FF000000FFULL;
+  const uint64_t mul1 = 100 + (1000000ULL << 32);
+  const uint64_t mul2 = 1 + (10000ULL << 32);
+  v -= 0x3030303030303030ULL;
+  v = (v * 10) + (v >> 8);
+  v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+  return (uint32_t)v;
+}
+
+static NumStatus StringParseDigits(const char *s, size_t len, uint64_t *value,
+                                   size_t *consumed) {
+  size_t i = 0;
+  while (i < len && s[i] == '0') {
+    i++;
+  }
+
+  // up to 19 significant digits always fit, so the first two chunks of eight
+  // are converted without overflow checks
+  uint64_t acc = 0;
+  size_t digits = 0;
+  while (len - i >= 8 && digits + 8 <= 19) {
+    const uint64_t chunk = StringLoadEight(s + i);
+    if (!StringIsEightDigits(chunk)) {
+      break;
+    }
+    acc = acc * 100000000ULL + StringParseEightDigits(chunk);
+    digits += 8;
+    i += 8;
+  }
+
+  bool overflow = false;
+  while (i < len && CharIsDigit(s[i])) {
+    const uint64_t d = (uint64_t)(s[i] - '0');
+    if (acc > UINT64_MAX / 10 ||
+        (acc == UINT64_MAX / 10 && d > UINT64_MAX % 10)) {
+      overflow = true;
+    } else {
+      acc = acc * 10 + d;
+    }
+    i++;
+  }
+
+  *consumed = i;
+  if (i == 0) {
+    return NumErrSyntax;
+  }
+
+  *value = overflow ? UINT64_MAX : acc;
+  return overflow ? NumErrRange : NumOk;
+}
+
+static size_t StringParseSign(const char *s, size_t len, bool *neg) {
+  size_t i = 0;
+  while (i < len && CharIsSpace(s[i])) {
+    i++;
+  }
+
+  *neg = false;
+  if (i < len && (s[i] == '-' || s[i] == '+')) {
+    *neg = s[i] == '-';
+    i++;
+  }
+
+  return i;
+}
+
+NumStatus StringParseUint64(const char *s, size_t len, uint64_t *value,
+                            const char **endptr) {
+  bool neg;
+  size_t consumed = 0;
+  const size_t start = StringParseSign(s, len, &neg);
+  NumStatus status = NumErrSyntax;
+  if (!neg) {
+    status = StringParseDigits(s + start, len - start, value, &consumed);
+  }
+
+  if (endptr) {
+    *endptr = status == NumErrSyntax ? s : s + start + consumed;
+  }
+  return status;
+}
+
+NumStatus StringParseInt64(const char *s, size_t len, int64_t *value,
+                           const char **endptr) {
+  bool neg;
+  size_t consumed = 0;
+  uint64_t mag = 0;
+  const size_t start = StringParseSign(s, len, &neg);
+  NumStatus status =
+      StringParseDigits(s + start, len - start, &mag, &consumed);
+
+  if (endptr) {
+    *endptr = status == NumErrSyntax ? s : s + start + consumed;
+  }
+
+  if (status == NumErrSyntax) {
+    return status;
+  }
+
+  const uint64_t limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+  if (status == NumErrRange || mag > limit) {
+    *value = neg ? INT64_MIN : INT64_MAX;
+    return NumErrRange;
+  }
+
+  *value = neg ? (mag == limit ? INT64_MIN : -(int64_t)mag) : (int64_t)mag;
+  return NumOk;
+}
+
+// StringParseFraction reads the digits after a decimal point, keeping the
+// first 18 in frac scaled by *scale, and returns how many it consumed.
+static size_t StringParseFraction(const char *s, size_t len, uint64_t *frac,
+                                  uint64_t *scale) {
+  size_t i = 0;
+  *frac = 0;
+  *scale = 1;
+  for (; i < len && CharIsDigit(s[i]); i++) {
+    if (*scale < 1000000000000000000ULL) {
+      *frac = *frac * 10 + (uint64_t)(s[i] - '0');
+      *scale *= 10;
+    }
+  }
+  return i;
+}
+
+// StringScaleTerm computes (v + frac / scale) * unit, failing when it
+// exceeds limit. The fraction is scaled in floating point, which is exact
+// for the short fractions written in practice.
+static bool StringScaleTerm(uint64_t v, uint64_t frac, uint64_t scale,
+                            uint64_t unit, uint64_t limit, uint64_t *out) {
+  if (v > limit / unit) {
+    return false;
+  }
+
+  uint64_t term = v * unit;
+  if (frac != 0) {
+    const uint64_t part =
+        (uint64_t)((double)frac * ((double)unit / (double)scale));
+    if (term > limit - part) {
+      return false;
+    }
+    term += part;
+  }
+
+  *out = term;
+  return true;
+}
+
+// StringParseNumber reads digits with an optional fraction, as in 1, 1.5 or
+// .5, and returns how many bytes it consumed, zero meaning no number.
+static size_t StringParseNumber(const char *s, size_t len, uint64_t *v,
+                                uint64_t *frac, uint64_t *scale,
+                                bool *overflow) {
+  size_t i = 0;
+  *v = 0;
+  *frac = 0;
+  *scale = 1;
+  *overflow = false;
+
+  if (i < len && CharIsDigit(s[i])) {
+    size_t consumed = 0;
+    *overflow = StringParseDigits(s, len, v, &consumed) == NumErrRange;
+    i += consumed;
+  }
+
+  if (i < len && s[i] == '.') {
+    const size_t n = StringParseFraction(s + i + 1, len - i - 1, frac, scale);
+    if (i == 0 && n == 0) {
+      return 0;
+    }
+    i += n + 1;
+  }
+
+  return i;
+}
+
+static uint64_t StringDurationUnit(const char *s, size_t len) {
+  if (len == 1) {
+    switch (s[0]) {
+    case 's':
+      return 1000000000ULL;
+    case 'm':
+      return 60000000000ULL;
+    case 'h':
+      return 3600000000000ULL;
+    }
+  } else if (len == 2 && s[1] == 's') {
+    switch (s[0]) {
+    case 'n':
+      return 1;
+    case 'u':
+      return 1000;
+    case 'm':
+      return 1000000;
+    }
+  } else if (len == 3 && s[2] == 's' &&
+             ((s[0] == '\xc2' && s[1] == '\xb5') ||
+              (s[0] == '\xce' && s[1] == '\xbc'))) {
+    // micro sign and greek small letter mu
+    return 1000;
+  }
+
+  return 0;
+}
+
+NumStatus StringParseDuration(const char *s, size_t len, int64_t *value,
+                              const char **endptr) {
+  bool neg;
+  size_t i = StringParseSign(s, len, &neg);
+  const uint64_t limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+  uint64_t total = 0;
+  bool range = false;
+  bool any = false;
+
+  while (i < len) {
+    uint64_t v;
+    uint64_t frac;
+    uint64_t scale;
+    bool overflow;
+    const size_t n = StringParseNumber(s + i, len - i, &v, &frac, &scale,
+                                       &overflow);
+    if (n == 0) {
+      break;
+    }
+
+    size_t j = i + n;
+    while (j < len && !CharIsDigit(s[j]) && s[j] != '.' && !CharIsSpace(s[j])) {
+      j++;
+    }
+
+    const uint64_t unit = StringDurationUnit(s + i + n, j - i - n);
+    if (unit == 0) {
+      if (!any && j == i + n && v == 0 && frac == 0 && !overflow) {
+        // a bare zero needs no unit
+        i = j;
+        any = true;
+      }
+      break;
+    }
+
+    uint64_t term;
+    if (overflow || !StringScaleTerm(v, frac, scale, unit, limit, &term) ||
+        term > limit - total) {
+      range = true;
+    } else {
+      total += term;
+    }
+
+    any = true;
+    i = j;
+  }
+
+  if (!any) {
+    if (endptr) {
+      *endptr = s;
+    }
+    return NumErrSyntax;
+  }
+
+  if (endptr) {
+    *endptr = s + i;
+  }
+
+  if (range) {
+    *value = neg ? INT64_MIN : INT64_MAX;
+    return NumErrRange;
+  }
+
+  *value = neg ? (total == limit ? INT64_MIN : -(int64_t)total)
+               : (int64_t)total;
+  return NumOk;
+}
+
+// StringByteSizeUnit accepts B and the SI (k, kB, ...) and IEC (Ki, KiB, ...)
+// prefixes up to exa in any case, returning 0 for anything else.
+static uint64_t StringByteSizeUnit(const char *s, size_t len) {
+  static const char prefixes[] = "kmgtpe";
+
+  if (len == 0) {
+    return 1;
+  }
+
+  const char c = (char)(s[0] | 0x20);
+  if (len == 1 && c == 'b') {
+    return 1;
+  }
+
+  const char *p = StringFindChar(prefixes, sizeof(prefixes) - 1, c);
+  if (p == prefixes + sizeof(prefixes) - 1) {
+    return 0;
+  }
+
+  size_t rest = 1;
+  const bool iec = rest < len && (s[rest] | 0x20) == 'i';
+  if (iec) {
+    rest++;
+  }
+
+  if (rest < len && (s[rest] | 0x20) == 'b') {
+    rest++;
+  }
+
+  if (rest != len) {
+    return 0;
+  }
+
+  uint64_t unit = 1;
+  for (const char *q = prefixes; q <= p; q++) {
+    unit *= iec ? 1024 : 1000;
+  }
+  return unit;
+}
+
+// StringWholeBytes checks that frac / scale of unit is a whole number of
+// bytes, as in 1.5KiB but not 1.1KiB, and stores it in part. Reducing by
+// the common divisor keeps the arithmetic exact and within 64 bits.
+static bool StringWholeBytes(const char *digits, size_t len, uint64_t frac,
+                             uint64_t scale, uint64_t unit, uint64_t *part) {
+  // StringParseFraction ignores digits past its precision, which must then
+  // all be zero
+  for (size_t i = 18; i < len; i++) {
+    if (digits[i] != '0') {
+      return false;
+    }
+  }
+
+  uint64_t a = scale;
+  uint64_t b = unit;
+  while (b != 0) {
+    const uint64_t t = a % b;
+    a = b;
+    b = t;
+  }
+
+  const uint64_t d = scale / a;
+  if (frac % d != 0) {
+    return false;
+  }
+
+  // frac < scale, so the part is below unit
+  *part = frac / d * (unit / a);
+  return true;
+}
+
+NumStatus StringParseByteSize(const char *s, size_t len, uint64_t *value,
+                              const char **endptr) {
+  bool neg;
+  const size_t start = StringParseSign(s, len, &neg);
+  uint64_t v;
+  uint64_t frac;
+  uint64_t scale;
+  bool overflow;
+  const size_t n = neg ? 0
+                       : StringParseNumber(s + start, len - start, &v, &frac,
+                                           &scale, &overflow);
+  if (n == 0) {
+    if (endptr) {
+      *endptr = s;
+    }
+    return NumErrSyntax;
+  }
+
+  // the unit may be separated from the number by blanks, as in 64 MiB
+  size_t i = start + n;
+  size_t j = i;
+  while (j < len && CharIsSpace(s[j])) {
+    j++;
+  }
+
+  size_t k = j;
+  while (k < len && !CharIsSpace(s[k])) {
+    k++;
+  }
+
+  uint64_t unit = StringByteSizeUnit(s + j, k - j);
+  if (unit != 0 && k > j) {
+    i = k;
+  } else {
+    unit = 1;
+  }
+
+  const char *dot = memchr(s + start, '.', n);
+  const char *digits = dot ? dot + 1 : s + start + n;
+  uint64_t part = 0;
+  if (!StringWholeBytes(digits, (size_t)(s + start + n - digits), frac, scale,
+                        unit, &part)) {
+    if (endptr) {
+      *endptr = s;
+    }
+    return NumErrSyntax;
+  }
+
+  if (endptr) {
+    *endptr = s + i;
+  }
+
+  if (overflow || v > UINT64_MAX / unit || v * unit > UINT64_MAX - part) {
+    *value = UINT64_MAX;
+    return NumErrRange;
+  }
+
+  *value = v * unit + part;
+  return NumOk;
+}
+
+static size_t StringFirstMarkedByte(uint64_t marks) {
+#if defined(__GNUC__)
+  return (size_t)__builtin_ctzll(marks) / 8;
+#else
+  size_t i = 0;
+  while ((marks & 0x80) == 0) {
+    marks >>= 8;
+    i++;
+  }
+  return i;
+#endif
+}
+
+const char *StringFindChar(const char *c, size_t len, char ch) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  const uint64_t pattern = ones * (unsigned char)ch;
+
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    // bytes equal to ch become zero, and the lowest zero byte is the first
+    // to get its high bit marked
+    const uint64_t v = StringLoadEight(c + i) ^ pattern;
+    const uint64_t marks = (v - ones) & ~v & highs;
+    if (marks) {
+      return c + i + StringFirstMarkedByte(marks);
+    }
+  }
+
+  while (i < len && c[i] != ch) {
+    i++;
+  }
+  return c + i;
+}
+
+// StringClassMarks sets the high bit of every byte of v in one of classes.
+// The classes only hold bytes below 0x80, so the tests run on the low seven
+// bits where adding to a byte never carries into the next one.
+static uint64_t StringClassMarks(uint64_t v, CharClass classes) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  const uint64_t low = v & ~highs;
+
+  uint64_t marks = 0;
+  if (classes & CharClassBlank) {
+    // \t to \r are the bytes from 9 to 13, and a byte equal to the space
+    // stays below 0x80 once 0x7f is added to its difference
+    marks |= (low + ones * (0x80 - '\t')) & ~(low + ones * (0x80 - '\r' - 1));
+    marks |= ~((low ^ (ones * ' ')) + ones * 0x7f);
+  }
+  if (classes & CharClassNewline) {
+    marks |= ~((low ^ (ones * '\n')) + ones * 0x7f);
+  }
+  return marks & ~v & highs;
+}
+
+#if defined(__SSE2__)
+// StringClassMask sets bit i of the result when byte i of v is in one of
+// classes. Subtracting \t maps \t to \r to 0..4, and an unsigned minimum
+// with 4 leaves exactly those bytes unchanged.
+static unsigned StringClassMask(__m128i v, CharClass classes) {
+  __m128i marks = _mm_setzero_si128();
+  if (classes & CharClassBlank) {
+    const __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    const __m128i range = _mm_min_epu8(t, _mm_set1_epi8('\r' - '\t'));
+    marks = _mm_or_si128(marks, _mm_cmpeq_epi8(range, t));
+    marks = _mm_or_si128(marks, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+  }
+  if (classes & CharClassNewline) {
+    marks = _mm_or_si128(marks, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+  }
+  return (unsigned)_mm_movemask_epi8(marks);
+}
+#endif
+
+// StringScanClass returns the first byte of c whose membership in classes
+// differs from skip. It tests 16 bytes per step with SSE2, then 8 bytes per
+// step, and looks the last bytes up in CharClassTable.
+static inline const char *StringScanClass(const char *c, size_t len,
+                                          CharClass classes, bool skip) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= len; i += 16) {
+    unsigned mask =
+        StringClassMask(_mm_loadu_si128((const __m128i *)(c + i)), classes);
+    if (skip) {
+      mask = ~mask & 0xffffu;
+    }
+    if (mask) {
+      return c + i + (size_t)__builtin_ctz(mask);
+    }
+  }
+#endif
+
+  for (; i + 8 <= len; i += 8) {
+    uint64_t marks = StringClassMarks(StringLoadEight(c + i), classes);
+    if (skip) {
+      marks = ~marks & 0x8080808080808080ULL;
+    }
+    if (marks) {
+      return c + i + StringFirstMarkedByte(marks);
+    }
+  }
+
+  while (i < len && CharIsClass(c[i], classes) == skip) {
+    i++;
+  }
+  return c + i;
+}
+
+const char *StringSkipClass(const char *c, size_t len, CharClass classes) {
+  return StringScanClass(c, len, classes, true);
+}
+
+const char *StringSkipNotClass(const char *c, size_t len, CharClass classes) {
+  return StringScanClass(c, len, classes, false);
+}
+
+const char *StringSkipLine(const char *c, size_t len) {
+  return StringScanClass(c, len, CharClassNewline, false);
+}
+
+const char *StringSkipBlank(const char *c, size_t len) {
+  return StringScanClass(c, len, CharClassBlank, true);
+}
+
+const char *StringSkipNonBlank(const char *c, size_t len) {
+  return StringScanClass(c, len, CharClassBlank, false);
+}
+
 int64_t StringToInt64(const char *nptr, size_t len, const char **endptr,
                       int base) {
+  if (base == 10) {
+    int64_t value = 0;
+    const char *end = NULL;
+    const NumStatus status = StringParseInt64(nptr, len, &value, &end);
+    if (status != NumErrSyntax) {
+      errno = status == NumErrRange ? ERANGE : 0;
+      if (endptr != 0) {
+        *endptr = end;
+      }
+      return value;
+    }
+  }
+
   const char *s = nptr;
   uint64_t acc;
   int c;
@@ -201,7 +817,7 @@ int64_t StringToInt64(const char *nptr, size_t len, const char **endptr,
    * Set any if any `digits' consumed; make it negative to indicate
    * overflow.
    */
-  cutoff = neg ? -(uint64_t)LONG_MIN : LONG_MAX;
+  cutoff = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
   cutlim = cutoff % (uint64_t)base;
   cutoff /= (uint64_t)base;
   for (acc = 0, any = 0;; c = *s++, len--) {
@@ -234,7 +850,7 @@ int64_t StringToInt64(const char *nptr, size_t len, const char **endptr,
   }
 
   if (any < 0) {
-    acc = neg ? LONG_MIN : LONG_MAX;
+    acc = neg ? (uint64_t)INT64_MIN : (uint64_t)INT64_MAX;
     errno = ERANGE;
   } else if (neg) {
     acc = -acc;
@@ -249,6 +865,19 @@ int64_t StringToInt64(const char *nptr, size_t len, const char **endptr,
 
 uint64_t StringToUint64(const char *nptr, size_t len, const char **endptr,
                         int base) {
+  if (base == 10) {
+    uint64_t value = 0;
+    const char *end = NULL;
+    const NumStatus status = StringParseUint64(nptr, len, &value, &end);
+    if (status != NumErrSyntax) {
+      errno = status == NumErrRange ? ERANGE : 0;
+      if (endptr != 0) {
+        *endptr = end;
+      }
+      return value;
+    }
+  }
+
   const char *s = nptr;
   uint64_t acc;
   int c;
@@ -287,8 +916,8 @@ uint64_t StringToUint64(const char *nptr, size_t len, const char **endptr,
     base = c == '0' ? 8 : 10;
   }
 
-  cutoff = (uint64_t)ULONG_MAX / (uint64_t)base;
-  cutlim = (uint64_t)ULONG_MAX % (uint64_t)base;
+  cutoff = UINT64_MAX / (uint64_t)base;
+  cutlim = UINT64_MAX % (uint64_t)base;
   for (acc = 0, any = 0;; c = *s++, len--) {
     if (isdigit(c)) {
       c -= '0';
@@ -316,7 +945,7 @@ uint64_t StringToUint64(const char *nptr, size_t len, const char **endptr,
     }
   }
   if (any < 0) {
-    acc = ULONG_MAX;
+    acc = UINT64_MAX;
     errno = ERANGE;
   } else if (neg) {
     acc = -acc;
@@ -14,8 +14,31 @@ typedef struct CharSlice {
   char __##name[cap];                                                          \
   CharSlice name = {.Cap = 0, .Value = __##name}
 
+// StringView borrows Len bytes starting at Ptr without owning them. The
+// bytes are not necessarily terminated by '\0'.
+typedef struct StringView {
+  const char *Ptr;
+  size_t Len;
+} StringView;
+
 typedef bool(CharSkipper)(char c);
 
+// CharClass names the sets of bytes in CharClassTable, which may be
+// combined. Blank is the C locale isspace set: space, \t, \n, \v, \f and
+// \r.
+typedef enum CharClass {
+  CharClassBlank = 1 << 0,
+  CharClassNewline = 1 << 1,
+} CharClass;
+
+extern const uint8_t CharClassTable[256];
+
+typedef enum NumStatus {
+  NumOk,
+  NumErrSyntax,
+  NumErrRange,
+} NumStatus;
+
 bool StringCaseEqualsWithLen(const char *a, size_t alen, const char *b,
                              size_t blen);
 bool StringCaseEquals(const char *a, const char *b);
@@ -31,6 +54,7 @@ bool CharIsNewline(char c);
 bool CharIsNotNewline(char c);
 bool CharIsBlank(char c);
 bool CharIsNotBlank(char c);
+bool CharIsClass(char c, CharClass classes);
 
 bool StringIsEmpty(const char *c);
 bool StringIsBlank(const char *c);
@@ -43,10 +67,64 @@ bool StringIsNotBlankWithLen(const char *c, size_t len);
 bool StringIsSubstringOf(const char *a, size_t alen, const char *s,
                          size_t slen);
 
+// StringHash computes the 64 bit FNV-1a hash of s. StringHashAppend extends
+// a hash started at StringHashOffset one span at a time.
+#define StringHashOffset 0xcbf29ce484222325ULL
+uint64_t StringHash(const char *s, size_t len);
+uint64_t StringHashAppend(uint64_t hash, const char *s, size_t len);
+
+// StringHashFolded hashes s as if its ASCII letters were lower case, to
+// pair with StringFoldEqualsWithLen. Unlike StringCaseEqualsWithLen it does
+// not depend on the locale.
+uint64_t StringHashFolded(const char *s, size_t len);
+bool StringFoldEqualsWithLen(const char *a, size_t alen, const char *b,
+                             size_t blen);
+
 const char *StringSkipChar(const char *c, size_t len, CharSkipper skipper);
+
+// StringSkipClass returns the first byte of c not in any of classes, and
+// StringSkipNotClass the first byte in one of them, or c + len. They test
+// 16 bytes per step with SSE2 and 8 bytes per step elsewhere, and
+// StringSkipLine, StringSkipBlank and StringSkipNonBlank are built on them.
+const char *StringSkipClass(const char *c, size_t len, CharClass classes);
+const char *StringSkipNotClass(const char *c, size_t len, CharClass classes);
 const char *StringSkipLine(const char *c, size_t len);
 const char *StringSkipBlank(const char *c, size_t len);
 const char *StringSkipNonBlank(const char *c, size_t len);
+const char *StringFindChar(const char *c, size_t len, char ch);
+
+// StringParseInt64 and StringParseUint64 convert the base 10 number at the
+// start of s, after optional blanks and sign, converting eight digits per
+// step. They do not read the locale nor write errno. On NumErrRange value is
+// clamped to the limit of its type. endptr, when not NULL, is set past the
+// last digit consumed.
+NumStatus StringParseInt64(const char *s, size_t len, int64_t *value,
+                           const char **endptr);
+NumStatus StringParseUint64(const char *s, size_t len, uint64_t *value,
+                            const char **endptr);
+
+// StringParseDuration converts a sequence of decimal numbers with units,
+// such as 1h30m or 2.5s, into nanoseconds. The units are ns, us (or µs), ms,
+// s, m and h, and a bare 0 needs none. StringParseByteSize converts a
+// number followed by an optional SI (kB, MB, ...) or IEC (KiB, MiB, ...)
+// suffix into bytes, rejecting with NumErrSyntax a fraction that is not a
+// whole number of bytes, such as 1.5 or 1.1KiB. Both check every
+// multiplication for overflow.
+NumStatus StringParseDuration(const char *s, size_t len, int64_t *value,
+                              const char **endptr);
+NumStatus StringParseByteSize(const char *s, size_t len, uint64_t *value,
+                              const char **endptr);
+
+// StringParseDouble and StringParseFloat convert the decimal number, inf,
+// infinity or nan at the start of s, after optional blanks and sign, to the
+// nearest representable value using the Eisel-Lemire algorithm. Like the
+// integer parsers they do not read the locale nor write errno. On
+// NumErrRange value is zero or infinity.
+NumStatus StringParseDouble(const char *s, size_t len, double *value,
+                            const char **endptr);
+NumStatus StringParseFloat(const char *s, size_t len, float *value,
+                           const char **endptr);
+
 int64_t StringToInt64(const char *nptr, size_t len, const char **endptr,
                       int base);
 uint64_t StringToUint64(const char *nptr, size_t len, const char **endptr,
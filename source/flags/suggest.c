@@ -0,0 +1,256 @@
+#include "suggest.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strings.h"
+
+static unsigned char SuggestFold(char c) {
+  return (unsigned char)(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+void FlagsMatcherInit(FlagsMatcher *matcher, const char *s, size_t len) {
+  memset(matcher->Peq, 0, sizeof(matcher->Peq));
+  matcher->Pattern = s;
+  matcher->Len = len;
+  if (len > 64) {
+    return;
+  }
+
+  // both cases of a letter match it, so that names are read unfolded
+  for (size_t i = 0; i < len; i++) {
+    const unsigned char c = SuggestFold(s[i]);
+    matcher->Peq[c] |= (uint64_t)1 << i;
+    if (c >= 'a' && c <= 'z') {
+      matcher->Peq[c - 'a' + 'A'] |= (uint64_t)1 << i;
+    }
+  }
+}
+
+// SuggestDistanceRows is the classic distance kept to a single row of
+// alen + 1 entries, for patterns that do not fit in a word. Like
+// SuggestDistance it stops with max + 1 once every entry of the row, and
+// so the distance, exceeds max.
+static size_t SuggestDistanceRows(const char *a, size_t alen, const char *b,
+                                  size_t blen, size_t max, size_t *row) {
+  for (size_t i = 0; i <= alen; i++) {
+    row[i] = i;
+  }
+
+  for (size_t j = 1; j <= blen; j++) {
+    size_t diag = row[0];
+    row[0] = j;
+    size_t least = j;
+    for (size_t i = 1; i <= alen; i++) {
+      const size_t up = row[i];
+      const size_t cost = SuggestFold(a[i - 1]) != SuggestFold(b[j - 1]);
+      size_t best = diag + cost;
+      if (up + 1 < best) {
+        best = up + 1;
+      }
+      if (row[i - 1] + 1 < best) {
+        best = row[i - 1] + 1;
+      }
+      row[i] = best;
+      least = best < least ? best : least;
+      diag = up;
+    }
+
+    if (least > max) {
+      return max + 1;
+    }
+  }
+
+  return row[alen];
+}
+
+// SuggestDistance returns the distance from the pattern of matcher to s, or
+// any value above max once the distance is known to exceed it. Patterns
+// longer than a word need a row of matcher->Len + 1 entries.
+static size_t SuggestDistance(const FlagsMatcher *matcher, const char *s,
+                              size_t len, size_t max, size_t *row) {
+  const size_t m = matcher->Len;
+  if (m > 64) {
+    return SuggestDistanceRows(matcher->Pattern, m, s, len, max, row);
+  }
+
+  if (m == 0) {
+    return len;
+  }
+
+  // Pv and Mv hold the vertical deltas of the current column, +1 and -1,
+  // and score tracks the last cell of the column
+  const unsigned shift = (unsigned)(m - 1);
+  uint64_t pv = ~(uint64_t)0;
+  uint64_t mv = 0;
+  size_t score = m;
+  for (size_t j = 0; j < len; j++) {
+    const uint64_t eq = matcher->Peq[(unsigned char)s[j]];
+    const uint64_t xv = eq | mv;
+    const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    score += (size_t)((ph >> shift) & 1);
+    score -= (size_t)((mh >> shift) & 1);
+
+    // every remaining character lowers the score by at most one
+    if (score > max + (len - j - 1)) {
+      return max + 1;
+    }
+
+    // the top row of the matrix grows by one per character of the name
+    ph = (ph << 1) | 1;
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+  }
+  return score;
+}
+
+size_t FlagsMatcherDistance(const FlagsMatcher *matcher, const char *s,
+                            size_t len) {
+  size_t *row = NULL;
+  if (matcher->Len > 64) {
+    row = malloc((matcher->Len + 1) * sizeof(size_t));
+    if (!row) {
+      return matcher->Len > len ? matcher->Len : len;
+    }
+  }
+
+  const size_t distance = SuggestDistance(matcher, s, len, SIZE_MAX - len, row);
+  free(row);
+  return distance;
+}
+
+// SuggestKeep inserts name into the sorted out unless it is further than
+// every kept suggestion and out is full.
+static void SuggestKeep(FlagSuggestion *out, size_t cap, size_t *len,
+                        const char *name, size_t distance) {
+  size_t pos = *len;
+  while (pos > 0 && out[pos - 1].Distance > distance) {
+    pos--;
+  }
+
+  if (pos == cap) {
+    return;
+  }
+
+  const size_t end = *len < cap ? *len : cap - 1;
+  memmove(&out[pos + 1], &out[pos], (end - pos) * sizeof(FlagSuggestion));
+  out[pos].Name = name;
+  out[pos].Distance = distance;
+  if (*len < cap) {
+    (*len)++;
+  }
+}
+
+static void SuggestItems(const FlagsMatcher *matcher, const HelpItem *items,
+                         size_t stride, size_t count, size_t max, size_t *row,
+                         FlagSuggestion *out, size_t cap, size_t *len) {
+  const char *ptr = (const char *)items;
+  for (size_t i = 0; i < count; i++, ptr += stride) {
+    const HelpItem *item = (const HelpItem *)ptr;
+    const size_t nameLen = item->NameLen ? item->NameLen : strlen(item->Name);
+    // the distance is at least the difference of the lengths
+    const size_t diff = nameLen > matcher->Len ? nameLen - matcher->Len
+                                               : matcher->Len - nameLen;
+    if (diff > max) {
+      continue;
+    }
+
+    const size_t distance =
+        SuggestDistance(matcher, item->Name, nameLen, max, row);
+    if (distance <= max) {
+      SuggestKeep(out, cap, len, item->Name, distance);
+    }
+  }
+}
+
+size_t FlagsSuggest(const Flags *flags, const char *token,
+                    FlagSuggestion *out, size_t cap) {
+  if (cap == 0) {
+    return 0;
+  }
+
+  const bool option = token[0] == '-';
+  const char *name = token;
+  if (option) {
+    name += token[1] == '-' ? 2 : 1;
+  }
+
+  const size_t nameLen = option ? strcspn(name, "=") : strlen(name);
+  FlagsMatcher matcher;
+  FlagsMatcherInit(&matcher, name, nameLen);
+
+  // the row for long tokens is shared by every candidate
+  size_t *row = NULL;
+  if (nameLen > 64) {
+    row = malloc((nameLen + 1) * sizeof(size_t));
+    if (!row) {
+      return 0;
+    }
+  }
+
+  const size_t max = nameLen < 3 ? 1 : (nameLen + 2) / 3;
+  size_t len = 0;
+  if (option) {
+    const FlagOptions *options = &flags->Options;
+    if (options->OptionsLen > 0) {
+      SuggestItems(&matcher, &options->Options[0].Help, sizeof(FlagOption),
+                   options->OptionsLen, max, row, out, cap, &len);
+    }
+  } else {
+    const FlagCommands *cmds = &flags->Commands;
+    if (cmds->CommandsLen > 0) {
+      SuggestItems(&matcher, &cmds->Commands[0].Help, sizeof(FlagCommand),
+                   cmds->CommandsLen, max, row, out, cap, &len);
+    }
+  }
+
+  free(row);
+  return len;
+}
+
+void FlagsReportError(const Flags *flags, int argc, char *argv[],
+                      FlagError err, int index) {
+  if (!err) {
+    return;
+  }
+
+  const bool named = flags && flags->ErrorOption >= 0 &&
+                     (size_t)flags->ErrorOption < flags->Options.OptionsLen &&
+                     (err == FlagErrMissingFlag || err == FlagErrConflict ||
+                      err == FlagErrDuplicateFlag);
+  fprintf(stderr, "%s: error: %s", argv[0], FlagErrorToString(err));
+  if (named) {
+    fprintf(stderr, " `-%s`",
+            flags->Options.Options[flags->ErrorOption].Help.Name);
+  } else if (index >= 0 && index < argc) {
+    fprintf(stderr, " `%s`", argv[index]);
+  }
+  fprintf(stderr, "\n");
+
+  if (!flags || index < 0 || index >= argc ||
+      (err != FlagErrUnknownFlag && err != FlagErrUnknownCommand)) {
+    return;
+  }
+
+  FlagSuggestion suggestions[FlagsMaxSuggestions];
+  const char *token = argv[index];
+  const size_t len =
+      FlagsSuggest(flags, token, suggestions, FlagsMaxSuggestions);
+  if (len == 0) {
+    return;
+  }
+
+  // suggestions keep the dashes the token was given with
+  const char *dashes = token[0] != '-' ? "" : token[1] == '-' ? "--" : "-";
+  fprintf(stderr, "%s: did you mean", argv[0]);
+  for (size_t i = 0; i < len; i++) {
+    fprintf(stderr, "%s %s%s", i == 0 ? "" : i + 1 == len ? " or" : ",",
+            dashes, suggestions[i].Name);
+  }
+  fprintf(stderr, "?\n");
+}
@@ -0,0 +1,46 @@
+#ifndef FLAGS_SUGGEST_H_
+#define FLAGS_SUGGEST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+
+#define FlagsMaxSuggestions 3
+
+// FlagsMatcher computes the edit distance from a pattern to many names with
+// Myers' bit-parallel algorithm, which advances a whole column of the
+// dynamic programming matrix per character of the name. Peq holds the
+// positions of every byte in the pattern, with letters in both cases so
+// that they are compared without case. Patterns longer than 64 bytes fall
+// back to a row by row distance.
+typedef struct FlagsMatcher {
+  uint64_t Peq[256];
+  const char *Pattern;
+  size_t Len;
+} FlagsMatcher;
+
+void FlagsMatcherInit(FlagsMatcher *matcher, const char *s, size_t len);
+size_t FlagsMatcherDistance(const FlagsMatcher *matcher, const char *s,
+                            size_t len);
+
+typedef struct FlagSuggestion {
+  const char *Name;
+  size_t Distance;
+} FlagSuggestion;
+
+// FlagsSuggest fills out with up to cap names closest to the unknown token,
+// nearest first, and returns how many it found. Options are suggested for a
+// token starting with a dash, without its dashes or value, and commands
+// otherwise. Names further than a third of the token, rounded up, are not
+// suggested, and most of them are skipped by their length alone.
+size_t FlagsSuggest(const Flags *flags, const char *token,
+                    FlagSuggestion *out, size_t cap);
+
+// FlagsReportError prints err like FlagsPrintError, naming the option an
+// error refers to and suggesting the closest names for unknown options and
+// commands.
+void FlagsReportError(const Flags *flags, int argc, char *argv[],
+                      FlagError err, int index);
+
+#endif // FLAGS_SUGGEST_H_
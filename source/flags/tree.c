@@ -0,0 +1,165 @@
+#include "tree.h"
+
+#include <string.h>
+
+#include "file.h"
+
+FlagNode FlagNewNode(uint32_t id, const char *name, const char *help,
+                     FlagOptions options, FlagNodes children,
+                     FlagNodeHandler handler) {
+  FlagNode node = {.Help = {.Name = name, .Help = help},
+                   .Id = id,
+                   .Flags = FlagsDefineOnlyOptions(options),
+                   .Children = children,
+                   .Handler = handler};
+  return node;
+}
+
+static FlagError FlagsTreeCompileNode(FlagNode *root, size_t depth) {
+  if (root->Children.Len > 0 && depth == FlagsMaxTreeDepth) {
+    // a path to the children would not fit in FlagsTreePath
+    return FlagErrTreeDepth;
+  }
+
+  FlagError err = FlagsCompile(&root->Flags);
+  if (err) {
+    return err;
+  }
+
+  FlagIndexRelease(&root->ChildIndex);
+  if (!FlagIndexInit(&root->ChildIndex, root->Children.Len)) {
+    return FlagErrNoMemory;
+  }
+
+  for (size_t i = 0; i < root->Children.Len; i++) {
+    FlagNode *child = &root->Children.Nodes[i];
+    child->Help.NameLen = strlen(child->Help.Name);
+    if (!FlagIndexInsert(&root->ChildIndex, child->Help.Name,
+                         child->Help.NameLen, i)) {
+      return FlagErrDuplicateName;
+    }
+
+    err = FlagsTreeCompileNode(child, depth + 1);
+    if (err) {
+      return err;
+    }
+  }
+
+  return Ok;
+}
+
+FlagError FlagsTreeCompile(FlagNode *root) {
+  return FlagsTreeCompileNode(root, 0);
+}
+
+void FlagsTreeRelease(FlagNode *root) {
+  for (size_t i = 0; i < root->Children.Len; i++) {
+    FlagsTreeRelease(&root->Children.Nodes[i]);
+  }
+
+  FlagIndexRelease(&root->ChildIndex);
+  FlagPrefixIndexRelease(&root->ChildPrefixes);
+  FlagsRelease(&root->Flags);
+}
+
+FlagNode *FlagsLookupNode(const FlagNode *node, const char *name,
+                          size_t len) {
+  if (FlagIndexIsCompiled(&node->ChildIndex)) {
+    size_t pos;
+    return FlagIndexFind(&node->ChildIndex, name, len, &pos)
+               ? &node->Children.Nodes[pos]
+               : NULL;
+  }
+
+  for (size_t i = 0; i < node->Children.Len; i++) {
+    FlagNode *child = &node->Children.Nodes[i];
+    if (StringEqualsWithLen(name, len, child->Help.Name,
+                            strlen(child->Help.Name))) {
+      return child;
+    }
+  }
+
+  return NULL;
+}
+
+FlagError FlagsTreeParse(FlagNode *root, int argc, char *argv[],
+                         FlagsTreePath *path, int *index) {
+  FlagNode *nodes[FlagsMaxTreeDepth + 1] = {root};
+  FlagNode *node = root;
+  int i = 1;
+  path->Len = 0;
+  FlagError err = FlagsBeginInput(&root->Flags);
+
+  while (i < argc && !err) {
+    const char *arg = argv[i];
+    *index = i;
+
+    if (arg[0] == '-' && arg[1] == '-' && arg[2] == '\0') {
+      i++;
+      break;
+
+    } else if (arg[0] == '-') {
+      int cargc = 0;
+      err = FlagsParseNextFlag(argc - i, argv + i, &node->Flags, &cargc);
+      i += cargc;
+
+    } else if (arg[0] == '@') {
+      err = FlagsParseFileArg(arg + 1, &node->Flags);
+      i++;
+
+    } else if (node->Children.Len == 0) {
+      // the remaining arguments belong to the command
+      break;
+
+    } else {
+      FlagNode *child = FlagsLookupNode(node, arg, strlen(arg));
+      if (!child) {
+        err = FlagErrUnknownCommand;
+        break;
+      }
+
+      if (path->Len == FlagsMaxTreeDepth) {
+        // only reachable for trees that were not compiled
+        err = FlagErrTreeDepth;
+        break;
+      }
+
+      path->Ids[path->Len++] = child->Id;
+      nodes[path->Len] = child;
+      node = child;
+      err = FlagsBeginInput(&node->Flags);
+      i++;
+    }
+  }
+
+  path->Node = node;
+  if (!err) {
+    *index = i;
+  }
+
+  // the options of every command on the path are checked once all of them
+  // have been given, and the sessions of all of them end here
+  for (size_t n = 0; n <= path->Len; n++) {
+    if (!err) {
+      err = FlagsCheck(&nodes[n]->Flags);
+    }
+    FlagsEndSession(&nodes[n]->Flags);
+  }
+  return err;
+}
+
+FlagError FlagsTreeDispatch(FlagNode *root, int argc, char *argv[],
+                            void *ctx, int *status, int *index) {
+  FlagsTreePath path;
+  FlagError err = FlagsTreeParse(root, argc, argv, &path, index);
+  if (err) {
+    return err;
+  }
+
+  if (!path.Node->Handler) {
+    return FlagErrMissingCommand;
+  }
+
+  *status = path.Node->Handler(ctx, &path, argc - *index, argv + *index);
+  return Ok;
+}
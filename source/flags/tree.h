@@ -0,0 +1,82 @@
+#ifndef FLAGS_TREE_H_
+#define FLAGS_TREE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flags.h"
+#include "index.h"
+
+#define FlagsMaxTreeDepth 16
+
+struct FlagNode;
+
+// FlagsTreePath records the commands resolved by FlagsTreeParse as the Id of
+// every node below the root, ending at Node.
+typedef struct FlagsTreePath {
+  uint32_t Ids[FlagsMaxTreeDepth];
+  size_t Len;
+  struct FlagNode *Node;
+} FlagsTreePath;
+
+// FlagNodeHandler runs the command at the end of path with the arguments
+// that follow it, and returns the exit status of the command.
+typedef int (*FlagNodeHandler)(void *ctx, const FlagsTreePath *path, int argc,
+                               char **argv);
+
+typedef struct FlagNodes {
+  size_t Len;
+  struct FlagNode *Nodes;
+} FlagNodes;
+
+// FlagNode is a command with its own options and child commands. Options
+// apply to the command they follow, as in app -v cluster drain -force.
+// ChildPrefixes is built for completion by FlagsTreeComplete.
+typedef struct FlagNode {
+  HelpItem Help;
+  uint32_t Id;
+  Flags Flags;
+  FlagNodes Children;
+  FlagIndex ChildIndex;
+  FlagPrefixIndex ChildPrefixes;
+  FlagNodeHandler Handler;
+} FlagNode;
+
+#define FlagNodesDeclare(var, ...)                                             \
+  FlagNode __##var[] = {__VA_ARGS__};                                          \
+  FlagNodes var = {                                                            \
+      .Len = sizeof(__##var) / sizeof(FlagNode),                               \
+      .Nodes = __##var,                                                        \
+  }
+
+#define FlagNodesNone ((FlagNodes){.Len = 0, .Nodes = NULL})
+
+FlagNode FlagNewNode(uint32_t id, const char *name, const char *help,
+                     FlagOptions options, FlagNodes children,
+                     FlagNodeHandler handler);
+
+// FlagsTreeCompile compiles the options of every node and indexes its
+// children by name. The indexes must be released with FlagsTreeRelease.
+// Trees with commands nested deeper than FlagsMaxTreeDepth are rejected with
+// FlagErrTreeDepth, which FlagsTreeParse also returns for such a path
+// through a tree that was not compiled.
+FlagError FlagsTreeCompile(FlagNode *root);
+void FlagsTreeRelease(FlagNode *root);
+
+FlagNode *FlagsLookupNode(const FlagNode *node, const char *name,
+                          size_t len);
+
+// FlagsTreeParse descends from root in a single pass over argv, applying the
+// options of each node it goes through. It stops at the first argument
+// that is not an option of a node without children, or after --, and sets
+// index to it.
+FlagError FlagsTreeParse(FlagNode *root, int argc, char *argv[],
+                         FlagsTreePath *path, int *index);
+
+// FlagsTreeDispatch parses argv with FlagsTreeParse and runs the handler of
+// the resolved command with the remaining arguments, storing its result in
+// status.
+FlagError FlagsTreeDispatch(FlagNode *root, int argc, char *argv[],
+                            void *ctx, int *status, int *index);
+
+#endif // FLAGS_TREE_H_
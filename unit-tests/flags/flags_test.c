@@ -1,7 +1,29 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
+#include <flags/buffer.h>
+#include <flags/cell.h>
+#include <flags/complete.h>
+#include <flags/env.h>
+#include <flags/file.h>
 #include <flags/flags.h>
+#include <flags/help.h>
+#include <flags/lazy.h>
+#include <flags/parse.h>
+#include <flags/reload.h>
+#include <flags/schema.h>
+#include <flags/serialize.h>
+#include <flags/shared.h>
+#include <flags/stats.h>
 #include <flags/strings.h>
+#include <flags/suggest.h>
+#include <flags/tree.h>
 
 #include "asserts.h"
 #include "runner.h"
@@ -252,6 +274,1466 @@ static int Test_FlagsCommandUnknown(void) {
   return EXIT_SUCCESS;
 }
 
+static int Test_FlagsCompiled(void) {
+  char stringValue[16] = "not set";
+  char cmd[16] = "not set";
+  bool boolValue = false;
+  int64_t int64Value = 0;
+  int argc = 6;
+  int index = -1;
+  char *argv[] = {"test", "-int64", "7", "-bool", "-string", "value"};
+  FlagCommandsDeclare(cmds, cmd, 16, FlagNewCommand("cmd1", "command one"),
+                      FlagNewCommand("cmd2", "command two"));
+  FlagOptionsDeclare(
+      options, FlagsNewString(stringValue, 16, "string", "my string value"),
+      FlagsNewBool(&boolValue, "bool", "my bool value"),
+      FlagsNewInt64(&int64Value, "int64", "my int64 value"), );
+  Flags flags = FlagsDefine(options, cmds);
+
+  AssertNotError(FlagsCompile(&flags));
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+  AssertNotError(err);
+  AssertStringEq(stringValue, "value");
+  AssertTrue(boolValue);
+  AssertEq(int64Value, 7);
+
+  char *unknown[] = {"test", "-int6"};
+  err = FlagsParse(2, unknown, &flags, &index);
+  AssertEq(err, FlagErrUnknownFlag);
+
+  char *command[] = {"test", "cmd2"};
+  err = FlagsParse(2, command, &flags, &index);
+  AssertNotError(err);
+  AssertStringEq(cmd, "cmd2");
+
+  FlagsRelease(&flags);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsCompileDuplicate(void) {
+  bool a = false;
+  bool b = false;
+  FlagOptionsDeclare(options, FlagsNewBool(&a, "bool", "first"),
+                     FlagsNewBool(&b, "bool", "second"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  AssertEq(FlagsCompile(&flags), FlagErrDuplicateName);
+  AssertFalse(FlagIndexIsCompiled(&flags.Options.Index));
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsStringViewFlag(void) {
+  StringView value = {.Ptr = NULL, .Len = 0};
+  StringView cmd = {.Ptr = NULL, .Len = 0};
+  char longValue[4096];
+  memset(longValue, 'x', sizeof(longValue) - 1);
+  longValue[sizeof(longValue) - 1] = '\0';
+  int argc = 4;
+  int index = -1;
+  char *argv[] = {"test", "-view", longValue, "cmd2"};
+  FlagCommandsDeclareView(cmds, &cmd, FlagNewCommand("cmd1", "command one"),
+                          FlagNewCommand("cmd2", "command two"));
+  FlagOptionsDeclare(options,
+                     FlagsNewStringView(&value, "view", "my view value"), );
+  Flags flags = FlagsDefine(options, cmds);
+
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+
+  AssertNotError(err);
+  AssertTrue(value.Ptr == argv[2]);
+  AssertEq(value.Len, sizeof(longValue) - 1);
+  AssertTrue(cmd.Ptr == argv[3]);
+  AssertEq(cmd.Len, 4u);
+  return EXIT_SUCCESS;
+}
+
+static bool WriteFile(const char *path, const char *contents) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = fputs(contents, file) >= 0;
+  return fclose(file) == 0 && ok;
+}
+
+static int Test_FlagsResponseFile(void) {
+  StringView view = {.Ptr = NULL, .Len = 0};
+  char value[16] = "not set";
+  bool boolValue = false;
+  int64_t int64Value = 0;
+  int argc = 4;
+  int index = -1;
+  char *argv[] = {"test", "-int64", "1", "@flags_test_outer.flags"};
+  FlagOptionsDeclare(
+      options, FlagsNewString(value, 16, "string", "my string value"),
+      FlagsNewStringView(&view, "view", "my view value"),
+      FlagsShort(FlagsNewBool(&boolValue, "bool", "my bool value"), 'b'),
+      FlagsShort(FlagsNewInt64(&int64Value, "int64", "my int64 value"), 'i'),
+  );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  AssertTrue(WriteFile("flags_test_outer.flags",
+                       "# comment line\n"
+                       "-string 'a value'\n"
+                       "  -bool @flags_test_inner.flags\n"));
+  AssertTrue(WriteFile("flags_test_inner.flags",
+                       "-int64 42 -view \"quoted -view\"\n"));
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+  AssertNotError(err);
+  AssertStringEq(value, "a value");
+  AssertTrue(boolValue);
+  AssertEq(int64Value, 42);
+  AssertEq(view.Len, 12u);
+  AssertTrue(memcmp(view.Ptr, "quoted -view", 12) == 0);
+
+  // a value starting with '#' is not a comment
+  const char *hash = "-string #fff -int64 9 # trailing\n";
+  AssertNotError(FlagsParseFileBuffer(hash, strlen(hash), &flags));
+  AssertStringEq(value, "#fff");
+  AssertEq(int64Value, 9);
+
+  // options follow the syntax of FlagsParse
+  const char *syntax = "--int64=80 --bool=false --string 'x y' -bi 7\n";
+  AssertNotError(FlagsParseFileBuffer(syntax, strlen(syntax), &flags));
+  AssertEq(int64Value, 7);
+  AssertTrue(boolValue);
+  AssertStringEq(value, "x y");
+  const char *cluster = "-i3 --bool=false\n";
+  AssertNotError(FlagsParseFileBuffer(cluster, strlen(cluster), &flags));
+  AssertEq(int64Value, 3);
+  AssertFalse(boolValue);
+  AssertEq(FlagsParseFileBuffer("-bx", 3, &flags), FlagErrUnknownFlag);
+  AssertEq(FlagsParseFileBuffer("--int64", 7, &flags), FlagErrNoArg);
+
+  AssertTrue(WriteFile("flags_test_inner.flags", "@flags_test_outer.flags"));
+  err = FlagsParseFile("flags_test_outer.flags", &flags);
+  AssertEq(err, FlagErrFileCycle);
+
+  err = FlagsParseFile("flags_test_missing.flags", &flags);
+  AssertEq(err, FlagErrFile);
+
+  FlagsRelease(&flags);
+  remove("flags_test_outer.flags");
+  remove("flags_test_inner.flags");
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsParseEnv(void) {
+  int64_t conns = 0;
+  bool verbose = false;
+  char region[16] = "not set";
+  uint32_t unbound = 0;
+  FlagListDeclare(ports, uint32_t, 4);
+  int index = -1;
+  char *envp[] = {"HOME=/root",  "APP_MAX_CONNS=64", "APP_VERBOSE=on",
+                  "REGION=west", "APP_UNBOUND=5",    "APP_PORT=80,81",
+                  NULL};
+  char *argv[] = {"test", "-max-conns", "128", "-port", "443", "-port", "8"};
+  FlagOptionsDeclare(
+      options,
+      FlagsBindEnv(FlagsNewInt64(&conns, "max-conns", "connections"), NULL),
+      FlagsBindEnv(FlagsNewBool(&verbose, "verbose", "verbose"), NULL),
+      FlagsBindEnv(FlagsNewString(region, 16, "region", "region"), "REGION"),
+      FlagsNewUint32(&unbound, "unbound", "not bound"),
+      FlagsBindEnv(FlagsNewUint32List(&ports, "port", "port"), NULL), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  FlagError err = FlagsParseEnv(&flags, "APP_", envp, &index);
+  AssertNotError(err);
+  AssertEq(conns, 64);
+  AssertTrue(verbose);
+  AssertStringEq(region, "west");
+  AssertEq(unbound, 0u);
+  AssertEq(ports.Len, (size_t)2);
+
+  err = FlagsParse(7, argv, &flags, &index);
+  AssertNotError(err);
+  AssertEq(conns, 128);
+  AssertEq(ports.Len, (size_t)2);
+  AssertEq(((uint32_t *)ports.Values)[0], 443u);
+  AssertEq(((uint32_t *)ports.Values)[1], 8u);
+
+  char *invalid[] = {"APP_MAX_CONNS=many", NULL};
+  err = FlagsParseEnv(&flags, "APP_", invalid, &index);
+  AssertEq(err, FlagErrParse);
+  AssertEq(index, 0);
+  AssertEq(flags.ErrorOption, 0);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsListFlags(void) {
+  FlagListDeclare(shards, int64_t, 8);
+  FlagListDeclare(ports, uint32_t, 2);
+  FlagListDeclare(hosts, StringView, 4);
+  int argc = 9;
+  int index = -1;
+  char *argv[] = {"test",   "-shard", "1",     "-shard", "7,9,-3",
+                  "-host",  "a,bb",   "-port", "80"};
+  FlagOptionsDeclare(options,
+                     FlagsNewInt64List(&shards, "shard", "shard ids"),
+                     FlagsNewUint32List(&ports, "port", "ports"),
+                     FlagsNewStringViewList(&hosts, "host", "hosts"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+  AssertNotError(err);
+  AssertEq(shards.Len, 4u);
+  int64_t *shardValues = shards.Values;
+  AssertEq(shardValues[0], 1);
+  AssertEq(shardValues[1], 7);
+  AssertEq(shardValues[2], 9);
+  AssertEq(shardValues[3], -3);
+  AssertEq(ports.Len, 1u);
+  AssertEq(((uint32_t *)ports.Values)[0], 80u);
+  AssertEq(hosts.Len, 2u);
+  StringView *hostValues = hosts.Values;
+  AssertEq(hostValues[1].Len, 2u);
+  AssertTrue(memcmp(hostValues[1].Ptr, "bb", 2) == 0);
+
+  char *full[] = {"test", "-port", "1,2,3,4"};
+  err = FlagsParse(3, full, &flags, &index);
+  AssertEq(err, FlagErrParse);
+  AssertEq(ports.Len, 5u);
+
+  char *empty[] = {"test", "-shard", "1,,2"};
+  err = FlagsParse(3, empty, &flags, &index);
+  AssertEq(err, FlagErrParse);
+  return EXIT_SUCCESS;
+}
+
+typedef struct TestRecord {
+  int64_t Conns;
+  bool Verbose;
+  StringView Name;
+  char Cmd[16];
+  int64_t Shards[4];
+  FlagList ShardList;
+} TestRecord;
+
+static int Test_FlagsParseBatch(void) {
+  TestRecord proto = {.Conns = -1};
+  proto.ShardList = (FlagList){.Values = proto.Shards, .Cap = 4, .Len = 0};
+  FlagCommandsDeclare(cmds, proto.Cmd, 16, FlagNewCommand("run", "run"),
+                      FlagNewCommand("stop", "stop"));
+  FlagOptionsDeclare(options,
+                     FlagsNewInt64(&proto.Conns, "conns", "connections"),
+                     FlagsNewBool(&proto.Verbose, "verbose", "verbose"),
+                     FlagsNewStringView(&proto.Name, "name", "name"),
+                     FlagsNewInt64List(&proto.ShardList, "shard", "shard"), );
+  Flags flags = FlagsDefine(options, cmds);
+  AssertNotError(FlagsCompile(&flags));
+
+  char buffers[64][64];
+  TestRecord records[64];
+  FlagsBatchItem items[64];
+  for (int i = 0; i < 64; i++) {
+    int len = snprintf(buffers[i], sizeof(buffers[i]),
+                       "prog%c-conns%c%d%c-name%cworker%c-shard%c%d,%d%c%s%c",
+                       0, 0, i, 0, 0, 0, 0, i, i + 1, 0,
+                       i % 2 ? "run" : "stop", 0);
+    records[i] = proto;
+    items[i].Buffer = buffers[i];
+    items[i].Len = (size_t)len;
+    items[i].Record = &records[i];
+  }
+
+  AssertNotError(FlagsParseBatch(&flags, &proto, sizeof(proto), items, 64, 4));
+  for (int i = 0; i < 64; i++) {
+    AssertNotError(items[i].Err);
+    AssertEq(records[i].Conns, i);
+    AssertFalse(records[i].Verbose);
+    AssertEq(records[i].Name.Len, 6u);
+    const char *cmd = i % 2 ? "run" : "stop";
+    AssertStringEq(records[i].Cmd, cmd);
+    // every record appends to its own copy of the list elements
+    AssertTrue(records[i].ShardList.Values == records[i].Shards);
+    AssertEq(records[i].ShardList.Len, (size_t)2);
+    AssertEq(records[i].Shards[0], i);
+    AssertEq(records[i].Shards[1], i + 1);
+  }
+  AssertEq(proto.Conns, -1);
+  AssertEq(proto.ShardList.Len, (size_t)0);
+
+  const char invalid[] = "prog\0-conns\0many";
+  int index = -1;
+  FlagsRecord record = {.Proto = &proto, .Size = sizeof(proto),
+                        .Base = &records[0]};
+  AssertEq(FlagsParseBuffer(&flags, invalid, sizeof(invalid), &record, &index),
+           FlagErrParse);
+  AssertEq(index, 2);
+
+  // list elements outside the prototype would be shared by every record
+  int64_t outside[4];
+  TestRecord other = proto;
+  other.ShardList.Values = outside;
+  TestRecord copy = other;
+  FlagOptionsDeclare(shared,
+                     FlagsNewInt64List(&other.ShardList, "shard", "shard"), );
+  Flags sharedFlags = FlagsDefineOnlyOptions(shared);
+  const FlagsRecord otherRecord = {
+      .Proto = &other, .Size = sizeof(other), .Base = &copy};
+  const char shards[] = "prog\0-shard\0001";
+  AssertEq(FlagsParseBuffer(&sharedFlags, shards, sizeof(shards),
+                            &otherRecord, &index),
+           FlagErrType);
+  AssertEq(copy.ShardList.Len, (size_t)0);
+
+  FlagsRelease(&flags);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsLazy(void) {
+  int64_t conns = 0;
+  uint32_t workers = 0;
+  char name[16] = "not set";
+  bool verbose = false;
+  int argc = 8;
+  int index = -1;
+  char *argv[] = {"test", "-conns", "64",  "-workers",
+                  "many", "-name",  "app", "-verbose"};
+  FlagOptionsDeclare(options, FlagsNewInt64(&conns, "conns", "connections"),
+                     FlagsNewUint32(&workers, "workers", "workers"),
+                     FlagsNewString(name, 16, "name", "name"),
+                     FlagsNewBool(&verbose, "verbose", "verbose"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  flags.Lazy = true;
+
+  FlagError err = FlagsParse(argc, argv, &flags, &index);
+  AssertNotError(err);
+  AssertEq(conns, 0);
+  AssertStringEq(name, "not set");
+  AssertTrue(verbose);
+
+  int64_t value = 0;
+  AssertNotError(FlagsGetInt64(&flags, "conns", &value));
+  AssertEq(value, 64);
+  AssertEq(conns, 64);
+  AssertFalse(flags.Options.Options[0].Pending);
+
+  const char *str = NULL;
+  AssertNotError(FlagsGetString(&flags, "name", &str));
+  AssertStringEq(str, "app");
+  AssertEq(FlagsGetUint64(&flags, "conns", NULL), FlagErrType);
+
+  uint32_t count = 0;
+  AssertEq(FlagsGetUint32(&flags, "workers", &count), FlagErrParse);
+  AssertEq(FlagsValidate(&flags, &index), FlagErrParse);
+  AssertEq(index, 1);
+
+  // a new parse resolves the values left pending by the previous one, and
+  // drops those that do not convert
+  char *again[] = {"test", "-conns", "8"};
+  AssertNotError(FlagsParse(3, again, &flags, &index));
+  AssertFalse(flags.Options.Options[1].Pending);
+  AssertNotError(FlagsValidate(&flags, &index));
+  AssertEq(conns, 8);
+
+  // a value given in one lazy session persists through the next, as it
+  // would in an eager parse
+  char *first[] = {"test", "-workers", "7"};
+  char *second[] = {"test", "-conns", "3"};
+  AssertNotError(FlagsParse(3, first, &flags, &index));
+  AssertEq(workers, 0u);
+  AssertNotError(FlagsParse(3, second, &flags, &index));
+  AssertEq(workers, 7u);
+  AssertFalse(flags.Options.Options[1].Pending);
+  AssertTrue(flags.Options.Options[0].Pending);
+  AssertNotError(FlagsValidate(&flags, &index));
+  AssertEq(conns, 3);
+  return EXIT_SUCCESS;
+}
+
+typedef struct TestReload {
+  size_t Calls;
+  size_t Changed;
+  size_t First;
+} TestReload;
+
+static void TestOnReload(void *ctx, const FlagsSnapshot *snapshot,
+                         const size_t *changed, size_t changedLen) {
+  (void)snapshot;
+  TestReload *reload = ctx;
+  reload->Calls++;
+  reload->Changed = changedLen;
+  reload->First = changed[0];
+}
+
+static int Test_FlagsReloader(void) {
+  TestRecord proto = {.Conns = 8};
+  FlagOptionsDeclare(options,
+                     FlagsNewInt64(&proto.Conns, "conns", "connections"),
+                     FlagsNewBool(&proto.Verbose, "verbose", "verbose"),
+                     FlagsNewStringView(&proto.Name, "name", "name"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  AssertNotError(FlagsCompile(&flags));
+
+  AssertTrue(WriteFile("flags_test_reload.flags", "-name app\n"));
+  FlagsReloader reloader;
+  TestReload reload = {.Calls = 0};
+  AssertNotError(FlagsReloaderInit(&reloader, &flags, &proto, sizeof(proto),
+                                   "flags_test_reload.flags"));
+  FlagsReloaderOnReload(&reloader, TestOnReload, &reload);
+
+  size_t reader = 0;
+  size_t other = 0;
+  AssertNotError(FlagsReloaderJoin(&reloader, &reader));
+  AssertNotError(FlagsReloaderJoin(&reloader, &other));
+  // readers write to cache lines of their own
+  AssertEq(sizeof(reloader.Readers[0]), (size_t)FlagsCacheLineSize);
+  AssertTrue(reader != other);
+
+  const TestRecord *record = FlagsReloaderAcquire(&reloader, reader);
+  AssertEq(record->Conns, 8);
+  AssertEq(record->Name.Len, 3u);
+
+  // the replaced snapshot survives the reload while reader holds it, and
+  // its views do not follow the file as it is rewritten in place
+  AssertTrue(WriteFile("flags_test_reload.flags", "-conns 16 -name app\n"));
+  AssertNotError(FlagsReloaderPoll(&reloader, 1000));
+  AssertTrue(memcmp(record->Name.Ptr, "app", 3) == 0);
+  const TestRecord *next = FlagsReloaderAcquire(&reloader, other);
+  AssertTrue(next != record);
+  AssertEq(next->Conns, 16);
+  AssertEq(record->Conns, 8);
+  AssertTrue(reloader.Retired != NULL);
+  AssertEq(reload.Calls, 1u);
+  AssertEq(reload.Changed, 1u);
+  AssertEq(reload.First, 0u);
+  AssertEq(FlagsReloaderSnapshot(&reloader, other)->Generation, 1u);
+
+  FlagsReloaderDone(&reloader, reader);
+  FlagsReloaderReclaim(&reloader);
+  AssertTrue(reloader.Retired == NULL);
+
+  AssertTrue(WriteFile("flags_test_reload.flags", "-conns many\n"));
+  AssertEq(FlagsReloaderReload(&reloader), FlagErrParse);
+  AssertTrue(FlagsReloaderAcquire(&reloader, reader) == next);
+
+  FlagsReloaderDone(&reloader, reader);
+  FlagsReloaderDone(&reloader, other);
+  FlagsReloaderLeave(&reloader, reader);
+  FlagsReloaderLeave(&reloader, other);
+  FlagsReloaderRelease(&reloader);
+  FlagsRelease(&flags);
+  remove("flags_test_reload.flags");
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsControl(void) {
+  atomic_bool verbose = false;
+  _Atomic int64_t conns = 8;
+  FlagCellStringDeclare(name, 8);
+  int64_t limit = 0;
+  int index = -1;
+  char *argv[] = {"test", "-verbose", "-name", "app"};
+  FlagOptionsDeclare(options,
+                     FlagsNewAtomicBool(&verbose, "verbose", "verbose"),
+                     FlagsNewAtomicInt64(&conns, "conns", "connections"),
+                     FlagsNewAtomicString(&name, "name", "name"),
+                     FlagsNewInt64(&limit, "limit", "limit"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  AssertNotError(FlagsParse(4, argv, &flags, &index));
+  AssertTrue(FlagCellLoadBool(&verbose));
+
+  char value[8];
+  AssertEq(FlagCellLoadString(&name, value, sizeof(value)), 3u);
+  AssertStringEq(value, "app");
+  AssertEq(FlagCellLoadString(&name, value, 0), 0u);
+  AssertStringEq(value, "app");
+
+  FlagsControl control;
+  unlink("flags_test.sock");
+  AssertNotError(FlagsControlOpen(&control, &flags, "flags_test.sock"));
+  AssertEq(FlagsControlGeneration(&control), 0u);
+  AssertEq(FlagsControlApply(&control, "conns=x", 7), FlagErrParse);
+  AssertEq(FlagsControlApply(&control, "limit=1", 7), FlagErrType);
+  AssertEq(FlagsControlApply(&control, "name=toolongname", 16),
+           FlagErrParse);
+  AssertEq(FlagCellLoadInt64(&conns), 8);
+  AssertEq(FlagsControlGeneration(&control), 0u);
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  strcpy(addr.sun_path, "flags_test.sock");
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  AssertTrue(fd >= 0);
+  AssertEq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+  const char *updates = "conns=32\nverbose=off\nname=web\nmissing=1\n";
+  AssertEq(write(fd, updates, strlen(updates)), (ssize_t)strlen(updates));
+  shutdown(fd, SHUT_WR);
+
+  AssertNotError(FlagsControlServe(&control, 1000));
+  char reply[256] = "";
+  AssertTrue(read(fd, reply, sizeof(reply) - 1) > 0);
+  close(fd);
+  AssertStringEq(reply, "ok\nok\nok\nerror: unknown option provided\n");
+
+  AssertEq(FlagCellLoadInt64(&conns), 32);
+  AssertFalse(FlagCellLoadBool(&verbose));
+  AssertEq(FlagCellLoadString(&name, value, sizeof(value)), 3u);
+  AssertStringEq(value, "web");
+  AssertEq(FlagsControlGeneration(&control), 3u);
+
+  FlagsControlClose(&control);
+  AssertTrue(access("flags_test.sock", F_OK) != 0);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsFormatHelp(void) {
+  bool verbose = false;
+  int64_t port = 0;
+  int64_t peers = 0;
+  char command[16] = "";
+  FlagOptionsDeclare(options, FlagsNewBool(&verbose, "verbose", "verbose"),
+                     FlagsGroup(FlagsNewInt64(&port, "port", "port"), "net"),
+                     FlagsGroup(FlagsNewInt64(&peers, "peers", "peers"),
+                                "net"), );
+  FlagCommandsDeclare(cmds, command, 16, FlagNewCommand("serve", "serve"), );
+  Flags flags = FlagsDefine(options, cmds);
+  AssertNotError(FlagsCompile(&flags));
+
+  char buf[256];
+  const char *full = "\nUSAGE:\tapp [OPTIONS] COMMAND\n\n"
+                     "OPTIONS:\n"
+                     "\t-verbose\tverbose\n"
+                     "\t-port\t\tport\n"
+                     "\t-peers\t\tpeers\n"
+                     "\n"
+                     "COMMANDS:\n"
+                     "\tserve\tserve\n"
+                     "\n";
+  AssertEq(FlagsFormatHelp(buf, sizeof(buf), "app", &flags, NULL),
+           strlen(full));
+  AssertStringEq(buf, full);
+
+  AssertEq(FlagsFormatHelp(buf, 8, "app", &flags, NULL), strlen(full));
+  AssertEq(strlen(buf), 7u);
+
+  FlagsHelpFilter group = {.Prefix = NULL, .Group = "net"};
+  FlagsFormatHelp(buf, sizeof(buf), "app", &flags, &group);
+  AssertStringEq(buf, "\nUSAGE:\tapp [OPTIONS] COMMAND\n\n"
+                      "OPTIONS:\n\t-port\tport\n\t-peers\tpeers\n\n");
+
+  FlagsHelpFilter prefix = {.Prefix = "pe", .Group = NULL};
+  FlagsFormatHelp(buf, sizeof(buf), "app", &flags, &prefix);
+  AssertStringEq(buf, "\nUSAGE:\tapp [OPTIONS] COMMAND\n\n"
+                      "OPTIONS:\n\t-peers\tpeers\n\n");
+
+  // a screen larger than the stack buffer is still written in full
+  char app[5000];
+  memset(app, 'a', sizeof(app) - 1);
+  app[sizeof(app) - 1] = 0;
+  const size_t len = FlagsFormatHelp(NULL, 0, app, &flags, NULL);
+  AssertEq(len, strlen(full) + sizeof(app) - 4);
+  FILE *file = tmpfile();
+  AssertTrue(file != NULL);
+  AssertNotError(FlagsWriteHelp(fileno(file), app, &flags, NULL));
+  char *written = malloc(len + 1);
+  char *expected = malloc(len + 1);
+  AssertTrue(written != NULL && expected != NULL);
+  rewind(file);
+  AssertEq(fread(written, 1, len + 1, file), len);
+  FlagsFormatHelp(expected, len + 1, app, &flags, NULL);
+  AssertEq(memcmp(written, expected, len), 0);
+  free(written);
+  free(expected);
+  fclose(file);
+
+  FlagsRelease(&flags);
+  return EXIT_SUCCESS;
+}
+
+#define TEST_SCHEMA(X, S)                                                      \
+  X(S, Int64, conns, "conns", "connections", 8)                                \
+  X(S, Bool, verbose, "verbose", "verbose", false)                             \
+  X(S, Duration, timeout, "timeout", "timeout", 1000)                          \
+  X(S, StringView, name, "name", "name", "app")
+
+FlagsSchemaDeclare(TestSchema, TEST_SCHEMA)
+
+static int Test_FlagsSchema(void) {
+  TestSchema config = TestSchemaDefaults;
+  AssertEq(config.conns, 8);
+  AssertEq(config.name.Len, 3u);
+  AssertEq(TestSchemaSchema[2].Type, FlagDuration);
+  AssertEq(TestSchemaSchema[2].Offset, offsetof(TestSchema, timeout));
+
+  int index = -1;
+  char *argv[] = {"test", "-verbose", "-conns", "16", "-timeout", "2s",
+                  "serve"};
+  AssertNotError(TestSchemaParse(&config, 7, argv, &index));
+  AssertEq(index, 6);
+  AssertTrue(config.verbose);
+  AssertEq(config.conns, 16);
+  AssertEq(config.timeout, 2000000000);
+
+  char *bad[] = {"test", "-name", "web", "-conn", "1"};
+  AssertEq(TestSchemaParse(&config, 5, bad, &index), FlagErrUnknownFlag);
+  AssertEq(index, 3);
+  AssertEq(config.name.Len, 3u);
+  AssertEq(TestSchemaParse(&config, 2, bad, &index), FlagErrNoArg);
+
+  char *syntax[] = {"test", "--conns=32", "--verbose=false", "--timeout",
+                    "1s",   "--",         "-name"};
+  AssertNotError(TestSchemaParse(&config, 7, syntax, &index));
+  AssertEq(index, 6);
+  AssertEq(config.conns, 32);
+  AssertFalse(config.verbose);
+  AssertEq(config.timeout, 1000000000);
+
+  char help[128];
+  FlagsFormatSchemaHelp(help, sizeof(help), TestSchemaSchema,
+                        TestSchemaSchemaLen, NULL);
+  AssertStringEq(help, "\t-conns\t\tconnections\n\t-verbose\tverbose\n"
+                       "\t-timeout\ttimeout\n\t-name\t\tname\n\n");
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsEnum(void) {
+  static const char *const choices[] = {"none", "lz4", "zstd", NULL};
+  int compression = -1;
+  int index = -1;
+  char *argv[] = {"test", "-compression", "ZSTD"};
+  FlagOptionsDeclare(options, FlagsNewEnum(&compression, choices,
+                                           "compression", "compression"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  AssertNotError(FlagsParse(3, argv, &flags, &index));
+  AssertEq(compression, 2);
+
+  AssertNotError(FlagsCompile(&flags));
+  argv[2] = "Lz4";
+  AssertNotError(FlagsParse(3, argv, &flags, &index));
+  AssertEq(compression, 1);
+  argv[2] = "gzip";
+  AssertEq(FlagsParse(3, argv, &flags, &index), FlagErrParse);
+  AssertEq(compression, 1);
+  FlagsRelease(&flags);
+
+  static const char *const duplicated[] = {"a", "A", NULL};
+  FlagOptionsDeclare(dupOptions,
+                     FlagsNewEnum(&compression, duplicated, "mode", "mode"), );
+  Flags dupFlags = FlagsDefineOnlyOptions(dupOptions);
+  AssertEq(FlagsCompile(&dupFlags), FlagErrDuplicateName);
+
+  bool value = false;
+  AssertTrue(ParseBool(&value, "Enabled", 7) && value);
+  AssertTrue(ParseBool(&value, "OFF", 3) && !value);
+  AssertTrue(ParseBool(&value, "2", 1) && value);
+  AssertFalse(ParseBool(&value, "onn", 3));
+  AssertFalse(ParseBool(&value, "yes", 3));
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsGnuSyntax(void) {
+  bool all = false;
+  bool verbose = false;
+  int64_t level = 0;
+  char output[16] = "";
+  int index = -1;
+  FlagOptionsDeclare(
+      options, FlagsShort(FlagsNewBool(&all, "all", "all"), 'a'),
+      FlagsShort(FlagsNewBool(&verbose, "verbose", "verbose"), 'v'),
+      FlagsShort(FlagsNewInt64(&level, "level", "level"), 'l'),
+      FlagsShort(FlagsNewString(output, sizeof(output), "output", "output"),
+                 'o'), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  char *argv[] = {"test", "--level=3", "-avofile", "--", "-x"};
+  AssertNotError(FlagsParse(5, argv, &flags, &index));
+  AssertEq(index, 4);
+  AssertTrue(all && verbose);
+  AssertEq(level, 3);
+  AssertStringEq(output, "file");
+
+  AssertNotError(FlagsCompile(&flags));
+  char *shorts[] = {"test", "-vl", "7", "--verbose=false", "-o", "out"};
+  AssertNotError(FlagsParse(6, shorts, &flags, &index));
+  AssertFalse(verbose);
+  AssertEq(level, 7);
+  AssertStringEq(output, "out");
+
+  char *unknown[] = {"test", "-ax"};
+  AssertEq(FlagsParse(2, unknown, &flags, &index), FlagErrUnknownFlag);
+  char *missing[] = {"test", "-al"};
+  AssertEq(FlagsParse(2, missing, &flags, &index), FlagErrNoArg);
+
+  const char buf[] = "test\0--level=9\0-va\0--output\0buf\0--\0-l";
+  AssertNotError(FlagsParseBuffer(&flags, buf, sizeof(buf), NULL, &index));
+  AssertEq(level, 9);
+  AssertEq(index, 6);
+  AssertStringEq(output, "buf");
+  FlagsRelease(&flags);
+  return EXIT_SUCCESS;
+}
+
+typedef struct TestTreeRun {
+  uint32_t Leaf;
+  size_t Depth;
+  int Argc;
+} TestTreeRun;
+
+static int TestTreeHandler(void *ctx, const FlagsTreePath *path, int argc,
+                           char **argv) {
+  (void)argv;
+  TestTreeRun *run = ctx;
+  run->Leaf = path->Ids[path->Len - 1];
+  run->Depth = path->Len;
+  run->Argc = argc;
+  return 3;
+}
+
+static int Test_FlagsTree(void) {
+  bool verbose = false;
+  bool force = false;
+  int64_t timeout = 0;
+  FlagOptionsDeclare(drainOptions, FlagsNewBool(&force, "force", "force"),
+                     FlagsNewInt64(&timeout, "timeout", "timeout"), );
+  const FlagOptions noOptions = FlagOptionsNone;
+  FlagNodesDeclare(nodeCommands,
+                   FlagNewNode(3, "drain", "drain a node", drainOptions,
+                               FlagNodesNone, TestTreeHandler),
+                   FlagNewNode(4, "list", "list nodes", noOptions,
+                               FlagNodesNone, TestTreeHandler), );
+  FlagNodesDeclare(clusterCommands,
+                   FlagNewNode(2, "node", "manage nodes", noOptions,
+                               nodeCommands, NULL), );
+  FlagNodesDeclare(rootCommands,
+                   FlagNewNode(1, "cluster", "manage the cluster", noOptions,
+                               clusterCommands, NULL), );
+  FlagOptionsDeclare(rootOptions,
+                     FlagsNewBool(&verbose, "verbose", "verbose"), );
+  FlagNode root =
+      FlagNewNode(0, "app", "app", rootOptions, rootCommands, NULL);
+
+  TestTreeRun run = {.Leaf = 0};
+  int status = 0;
+  int index = -1;
+  char *argv[] = {"app",    "-verbose", "cluster", "node",  "drain",
+                  "-force", "-timeout", "30",      "node-1"};
+  AssertNotError(FlagsTreeDispatch(&root, 9, argv, &run, &status, &index));
+  AssertEq(status, 3);
+  AssertEq(index, 8);
+  AssertEq(run.Leaf, 3u);
+  AssertEq(run.Depth, 3u);
+  AssertEq(run.Argc, 1);
+  AssertTrue(verbose && force);
+  AssertEq(timeout, 30);
+
+  AssertNotError(FlagsTreeCompile(&root));
+  char *list[] = {"app", "cluster", "node", "list"};
+  AssertNotError(FlagsTreeDispatch(&root, 4, list, &run, &status, &index));
+  AssertEq(run.Leaf, 4u);
+
+  char *inner[] = {"app", "cluster", "node"};
+  AssertEq(FlagsTreeDispatch(&root, 3, inner, &run, &status, &index),
+           FlagErrMissingCommand);
+  char *unknown[] = {"app", "cluster", "nodes"};
+  AssertEq(FlagsTreeDispatch(&root, 3, unknown, &run, &status, &index),
+           FlagErrUnknownCommand);
+  AssertEq(index, 2);
+  char *misplaced[] = {"app", "cluster", "-force"};
+  AssertEq(FlagsTreeDispatch(&root, 3, misplaced, &run, &status, &index),
+           FlagErrUnknownFlag);
+  FlagsTreeRelease(&root);
+
+  // a chain of commands one level deeper than a path can record
+  FlagNode chain[FlagsMaxTreeDepth + 2];
+  char *deep[FlagsMaxTreeDepth + 2];
+  FlagsTreePath path;
+  for (size_t n = FlagsMaxTreeDepth + 2; n-- > 0;) {
+    const bool leaf = n == FlagsMaxTreeDepth + 1;
+    const FlagNodes children = {.Len = leaf ? 0 : 1,
+                                .Nodes = leaf ? NULL : &chain[n + 1]};
+    chain[n] = FlagNewNode((uint32_t)n, "x", "x", noOptions, children,
+                           TestTreeHandler);
+    deep[n] = n > 0 ? "x" : "app";
+  }
+  AssertEq(FlagsTreeParse(&chain[0], FlagsMaxTreeDepth + 2, deep, &path,
+                          &index),
+           FlagErrTreeDepth);
+  AssertEq(FlagsTreeCompile(&chain[0]), FlagErrTreeDepth);
+  FlagsTreeRelease(&chain[0]);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsStats(void) {
+  char name[16] = "";
+  int64_t count = 0;
+  FlagOptionsDeclare(options, FlagsNewString(name, 16, "name", "name"),
+                     FlagsNewInt64(&count, "count", "count"), );
+  FlagsStats stats = {.Tokens = 0};
+  Flags flags = FlagsDefineOnlyOptions(options);
+  flags.Stats = &stats;
+
+  int index = -1;
+  char *argv[] = {"test", "-name", "abc", "--count=3", "--", "rest"};
+  AssertNotError(FlagsParse(6, argv, &flags, &index));
+  AssertStringEq(name, "abc");
+  AssertEq(count, 3);
+#ifdef FLAGS_ENABLE_STATS
+  AssertEq(stats.Tokens, (uint64_t)4);
+  AssertEq(stats.BytesCopied, (uint64_t)3);
+  AssertEq(stats.Compares, (uint64_t)2);
+  AssertTrue(stats.Slowest != NULL);
+
+  // a name too long for its buffer is rejected and copies nothing, and
+  // parsing into a record leaves the shared stats alone
+  char *longName[] = {"test", "-name", "a name that is too long"};
+  AssertEq(FlagsParse(3, longName, &flags, &index), FlagErrParse);
+  AssertEq(stats.BytesCopied, (uint64_t)3);
+  const uint64_t probes = stats.Probes + stats.Compares;
+  const char buf[] = "test\0-count\0004";
+  AssertNotError(FlagsParseBuffer(&flags, buf, sizeof(buf), NULL, &index));
+  AssertEq(stats.Probes + stats.Compares, probes);
+#else
+  AssertEq(stats.Tokens, (uint64_t)0);
+#endif
+
+  FlagsStats fixed = {.Tokens = 4,
+                      .Probes = 5,
+                      .Compares = 2,
+                      .BytesCopied = 3,
+                      .TokenizeNs = 10,
+                      .LookupNs = 20,
+                      .ConvertNs = 30,
+                      .SlowestNs = 25,
+                      .Slowest = &options.Options[1]};
+  char line[256];
+  const char *expected =
+      "flags_stats tokens=4 probes=5 compares=2 bytes_copied=3 tokenize_ns=10 "
+      "lookup_ns=20 convert_ns=30 slowest=count slowest_ns=25\n";
+  AssertEq(FlagsStatsFormat(line, sizeof(line), &fixed), strlen(expected));
+  AssertStringEq(line, expected);
+  AssertEq(FlagsStatsFormat(line, 12, &fixed), strlen(expected));
+  AssertStringEq(line, "flags_stats");
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsSerialize(void) {
+  char name[16] = "";
+  StringView view = {.Ptr = NULL, .Len = 0};
+  int64_t count = 0;
+  double ratio = 0;
+  int mode = 0;
+  _Atomic uint32_t limit = 0;
+  FlagCellStringDeclare(label, 16);
+  FlagListDeclare(ports, uint32_t, 4);
+  static const char *const modes[] = {"fast", "safe", NULL};
+  FlagOptionsDeclare(options, FlagsNewString(name, 16, "name", "name"),
+                     FlagsNewStringView(&view, "view", "view"),
+                     FlagsNewInt64(&count, "count", "count"),
+                     FlagsNewDouble(&ratio, "ratio", "ratio"),
+                     FlagsNewEnum(&mode, modes, "mode", "mode"),
+                     FlagsNewAtomicUint32(&limit, "limit", "limit"),
+                     FlagsNewAtomicString(&label, "label", "label"),
+                     FlagsNewUint32List(&ports, "port", "port"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  flags.Lazy = true;
+
+  int index = -1;
+  char *argv[] = {"test", "-name",  "abc",    "-view",  "xyz",  "-count",
+                  "-7",   "-ratio", "0.25",   "-mode",  "safe", "-limit",
+                  "9",    "-label", "blue",   "-port",  "80,443"};
+  AssertNotError(FlagsParse(17, argv, &flags, &index));
+  size_t len = 0;
+  AssertEq(FlagsSerialize(&flags, NULL, 0, &len), FlagErrNoMemory);
+  uint8_t blob[256];
+  AssertTrue(len <= sizeof(blob));
+  AssertNotError(FlagsSerialize(&flags, blob, sizeof(blob), &len));
+
+  memset(name, 0, sizeof(name));
+  view.Len = 0;
+  count = 0;
+  ratio = 0;
+  mode = 0;
+  atomic_store(&limit, 0);
+  FlagCellStoreString(&label, "", 0);
+  ports.Len = 0;
+  AssertNotError(FlagsDeserialize(&flags, blob, len));
+  AssertStringEq(name, "abc");
+  AssertTrue(view.Len == 3 && memcmp(view.Ptr, "xyz", 3) == 0);
+  AssertEq(count, -7);
+  AssertTrue(ratio == 0.25);
+  AssertEq(mode, 1);
+  AssertEq(FlagCellLoadUint32(&limit), 9u);
+  char out[16];
+  AssertEq(FlagCellLoadString(&label, out, sizeof(out)), (size_t)4);
+  AssertStringEq(out, "blue");
+  AssertEq(ports.Len, (size_t)2);
+  AssertEq(((uint32_t *)ports.Values)[1], 443u);
+
+  AssertEq(FlagsDeserialize(&flags, blob, len - 1), FlagErrSchema);
+
+  // an enum index past the choices rejects the blob before name is stored;
+  // mode is followed by limit, label and the two ports
+  strcpy(name, "kept");
+  uint8_t *index32 = blob + len - 4 - (4 + 4) - (4 + 2 * 4) - 4;
+  AssertEq(index32[0], 1u);
+  index32[0] = 2;
+  AssertEq(FlagsDeserialize(&flags, blob, len), FlagErrSchema);
+  AssertStringEq(name, "kept");
+  AssertEq(mode, 1);
+  index32[0] = 1;
+
+  // an enum left without a choice restores, one past its choices does not
+  // serialize; the view restored above points into blob
+  uint8_t unset[256];
+  size_t unsetLen = 0;
+  mode = -1;
+  AssertNotError(FlagsSerialize(&flags, unset, sizeof(unset), &unsetLen));
+  mode = 0;
+  AssertNotError(FlagsDeserialize(&flags, unset, unsetLen));
+  AssertEq(mode, -1);
+  mode = 2;
+  AssertEq(FlagsSerialize(&flags, unset, sizeof(unset), &unsetLen),
+           FlagErrSchema);
+
+  options.Options[2].Help.Name = "counts";
+  AssertEq(FlagsDeserialize(&flags, blob, len), FlagErrSchema);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsShared(void) {
+  char name[16] = "";
+  int64_t count = 0;
+  _Atomic uint32_t limit = 0;
+  FlagListDeclare(ports, uint32_t, 4);
+  FlagListDeclare(hosts, StringView, 4);
+  FlagOptionsDeclare(options, FlagsNewString(name, 16, "name", "name"),
+                     FlagsNewInt64(&count, "count", "count"),
+                     FlagsNewAtomicUint32(&limit, "limit", "limit"),
+                     FlagsNewUint32List(&ports, "port", "port"),
+                     FlagsNewStringViewList(&hosts, "host", "host"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+
+  int index = -1;
+  char *argv[] = {"test",  "-name", "abc",    "-count", "-7",    "-limit",
+                  "9",     "-port", "80,443", "-host",  "a,bcd"};
+  AssertNotError(FlagsParse(11, argv, &flags, &index));
+  int fd = -1;
+  AssertNotError(FlagsSharedPublish(&flags, &fd));
+  AssertTrue(mmap(NULL, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) ==
+             MAP_FAILED);
+
+  FlagsShared shared;
+  AssertNotError(FlagsSharedOpen(&shared, fd, &flags));
+  StringView view;
+  AssertNotError(FlagsSharedGetString(&shared, 0, &view));
+  AssertStringEq(view.Ptr, "abc");
+  int64_t i64 = 0;
+  AssertNotError(FlagsSharedGetInt64(&shared, 1, &i64));
+  AssertEq(i64, -7);
+  AssertEq(FlagsSharedGetInt32(&shared, 1, NULL), FlagErrType);
+  uint32_t u32 = 0;
+  AssertNotError(FlagsSharedGetUint32(&shared, 2, &u32));
+  AssertEq(u32, 9u);
+  const uint32_t *values = NULL;
+  size_t len = 0;
+  AssertNotError(FlagsSharedGetUint32List(&shared, 3, &values, &len));
+  AssertEq(len, (size_t)2);
+  AssertEq(values[1], 443u);
+  AssertNotError(FlagsSharedGetStringViewList(&shared, 4, &len));
+  AssertEq(len, (size_t)2);
+  AssertNotError(FlagsSharedGetListString(&shared, 4, 1, &view));
+  AssertStringEq(view.Ptr, "bcd");
+  AssertEq(FlagsSharedGetBool(&shared, 5, NULL), FlagErrUnknownFlag);
+
+  // the same bytes in a file that is not sealed are refused
+  FILE *copy = fopen("flags_test.shared", "w+");
+  AssertTrue(copy != NULL);
+  AssertEq(fwrite(shared.Base, 1, shared.Len, copy), shared.Len);
+  AssertEq(fflush(copy), 0);
+  FlagsShared unsealed;
+  AssertEq(FlagsSharedOpen(&unsealed, fileno(copy), &flags), FlagErrSchema);
+  fclose(copy);
+  unlink("flags_test.shared");
+  FlagsSharedClose(&shared);
+
+  options.Options[1].Help.Name = "counts";
+  AssertEq(FlagsSharedOpen(&shared, fd, &flags), FlagErrSchema);
+  close(fd);
+  return EXIT_SUCCESS;
+}
+
+static int Test_FlagsRules(void) {
+  char cert[16] = "";
+  char key[16] = "";
+  bool plain = false;
+  int64_t port = 0;
+  int64_t level = 0;
+  FlagOptionsDeclare(
+      options, FlagsNewString(cert, 16, "cert", "cert"),
+      FlagsNewString(key, 16, "key", "key"),
+      FlagsNewBool(&plain, "plain", "plain"),
+      FlagsDuplicates(
+          FlagsRequired(FlagsBindEnv(FlagsNewInt64(&port, "port", "port"),
+                                     NULL)),
+          FlagDuplicatesError),
+      FlagsDuplicates(FlagsNewInt64(&level, "level", "level"),
+                      FlagDuplicatesFirstWins), );
+  static const char *const tls[] = {"cert", "key", NULL};
+  static const char *const modes[] = {"cert", "plain", NULL};
+  FlagRulesDeclare(rules, FlagNewRequires(tls), FlagNewConflict(modes), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  flags.Rules = rules;
+  AssertEq(flags.ErrorOption, -1);
+
+  for (int compiled = 0; compiled < 2; compiled++) {
+    int index = -1;
+    char *ok[] = {"test", "-level", "1", "-cert", "a", "-key", "b",
+                  "-level", "2", "-port", "80"};
+    AssertNotError(FlagsParse(11, ok, &flags, &index));
+    AssertEq(level, 1);
+    AssertEq(flags.ErrorOption, -1);
+
+    char *missing[] = {"test", "-plain"};
+    AssertEq(FlagsParse(2, missing, &flags, &index), FlagErrMissingFlag);
+    AssertEq(flags.ErrorOption, 3);
+
+    char *twice[] = {"test", "-port", "1", "-port", "2"};
+    AssertEq(FlagsParse(5, twice, &flags, &index), FlagErrDuplicateFlag);
+    AssertEq(flags.ErrorOption, 3);
+    AssertEq(index, 3);
+
+    char *requires[] = {"test", "-port", "1", "-cert", "a"};
+    AssertEq(FlagsParse(5, requires, &flags, &index), FlagErrMissingFlag);
+    AssertEq(flags.ErrorOption, 1);
+
+    char *conflict[] = {"test", "-port", "1", "-plain", "-cert", "a",
+                        "-key", "b"};
+    AssertEq(FlagsParse(8, conflict, &flags, &index), FlagErrConflict);
+    AssertEq(flags.ErrorOption, 2);
+
+    // the environment is an earlier input of the same session, which the
+    // command line overrides without repeating the option
+    char *envp[] = {"APP_PORT=80", NULL};
+    char *plain[] = {"test", "-plain"};
+    AssertNotError(FlagsParseEnv(&flags, "APP_", envp, &index));
+    AssertNotError(FlagsParse(2, plain, &flags, &index));
+    AssertEq(port, 80);
+    AssertNotError(FlagsParseEnv(&flags, "APP_", envp, &index));
+    AssertNotError(FlagsParse(3, (char *[]){"test", "-port", "90"}, &flags,
+                              &index));
+    AssertEq(port, 90);
+    AssertEq(FlagsParse(2, plain, &flags, &index), FlagErrMissingFlag);
+
+    const char buf[] = "test\0-plain";
+    AssertEq(FlagsParseBuffer(&flags, buf, sizeof(buf), NULL, &index),
+             FlagErrMissingFlag);
+
+    AssertNotError(FlagsCompile(&flags));
+  }
+
+  FlagsRelease(&flags);
+
+  // flags that are not compiled track more than 64 options too
+  bool wide[70];
+  char names[70][8];
+  FlagOption wideOptions[70];
+  for (int i = 0; i < 70; i++) {
+    snprintf(names[i], sizeof(names[i]), "o%d", i);
+    wideOptions[i] = FlagsNewBool(&wide[i], names[i], "wide");
+  }
+  wideOptions[69] = FlagsRequired(wideOptions[69]);
+  FlagOptions wideList = {.OptionsLen = 70, .Options = wideOptions};
+  Flags many = FlagsDefineOnlyOptions(wideList);
+  int index = -1;
+  char *none[] = {"test"};
+  AssertNotError(FlagsParseFileBuffer("-o69", 4, &many));
+  AssertNotError(FlagsParse(1, none, &many, &index));
+  AssertEq(FlagsParse(1, none, &many, &index), FlagErrMissingFlag);
+  AssertEq(many.ErrorOption, 69);
+  AssertTrue(many.Options.Seen == NULL);
+
+  FlagNode root = FlagNewNode(0, "app", "app", wideList, FlagNodesNone, NULL);
+  FlagsTreePath path;
+  AssertEq(FlagsTreeParse(&root, 1, none, &path, &index), FlagErrMissingFlag);
+  FlagsTreeRelease(&root);
+  FlagsRelease(&many);
+  return EXIT_SUCCESS;
+}
+
+// TestCompleteRead returns what a completion function wrote into fds.
+static size_t TestCompleteRead(int fds[2], char *out, size_t cap) {
+  close(fds[1]);
+  size_t len = 0;
+  ssize_t n;
+  while ((n = read(fds[0], out + len, cap - len - 1)) > 0) {
+    len += (size_t)n;
+  }
+  close(fds[0]);
+  out[len] = '\0';
+  return len;
+}
+
+static int Test_FlagsComplete(void) {
+  int64_t limit = 0;
+  int level = 0;
+  char cmd[16] = "";
+  static const char *const levels[] = {"debug", "info", "warn", NULL};
+  FlagCommandsDeclare(cmds, cmd, 16, FlagNewCommand("serve", "serve"),
+                      FlagNewCommand("status", "show status"),
+                      FlagNewCommand("stop", "stop"));
+  FlagOptionsDeclare(options, FlagsNewInt64(&limit, "limit", "max clients"),
+                     FlagsNewEnum(&level, levels, "level", "log level"),
+                     FlagsNewInt64(&limit, "listen", "port"), );
+  Flags flags = FlagsDefine(options, cmds);
+
+  char out[512];
+  int fds[2];
+  char *words[] = {"app", "--li", "x"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsComplete(&flags, 2, words, 1, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "--limit\tmax clients\n--listen\tport\n");
+
+  char *st[] = {"app", "st"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsComplete(&flags, 2, st, 1, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "status\tshow status\nstop\tstop\n");
+
+  char *value[] = {"app", "-level", "d"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsComplete(&flags, 3, value, 2, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "debug\t\n");
+
+  char *folded[] = {"app", "-level", "WA"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsComplete(&flags, 3, folded, 2, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "warn\t\n");
+
+  char *attached[] = {"app", "--level=", "serve"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsComplete(&flags, 2, attached, 1, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "--level=debug\t\n--level=info\t\n--level=warn\t\n");
+
+  bool force = false;
+  FlagOptionsDeclare(drainOptions, FlagsNewBool(&force, "force", "force"), );
+  const FlagOptions noOptions = FlagOptionsNone;
+  FlagNodesDeclare(nodeCommands,
+                   FlagNewNode(2, "drain", "drain a node", drainOptions,
+                               FlagNodesNone, NULL),
+                   FlagNewNode(3, "list", "list nodes", noOptions,
+                               FlagNodesNone, NULL), );
+  FlagNodesDeclare(rootCommands,
+                   FlagNewNode(1, "node", "manage nodes", noOptions,
+                               nodeCommands, NULL), );
+  FlagNode root = FlagNewNode(0, "app", "app", noOptions, rootCommands, NULL);
+  char *tree[] = {"app", "node", ""};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsTreeComplete(&root, 3, tree, 2, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "drain\tdrain a node\nlist\tlist nodes\n");
+
+  char *drain[] = {"app", "node", "drain", "-f"};
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsTreeComplete(&root, 4, drain, 3, fds[1]));
+  TestCompleteRead(fds, out, sizeof(out));
+  AssertStringEq(out, "-force\tforce\n");
+
+  AssertEq(pipe(fds), 0);
+  AssertNotError(FlagsWriteCompletion(fds[1], "my-app", FlagsShellBash));
+  TestCompleteRead(fds, out, sizeof(out));
+  const char *strip = "%%$'\\t'*";
+  AssertTrue(strstr(out, "-F _my_app_complete my-app\n") != NULL);
+  AssertTrue(strstr(out, strip) != NULL);
+
+  FlagsRelease(&flags);
+  FlagsTreeRelease(&root);
+  return EXIT_SUCCESS;
+}
+
+// TestEditDistance is the textbook distance that FlagsMatcher must match.
+static size_t TestEditDistance(const char *a, size_t alen, const char *b,
+                               size_t blen) {
+  size_t d[24][24];
+  for (size_t i = 0; i <= alen; i++) {
+    for (size_t j = 0; j <= blen; j++) {
+      if (i == 0 || j == 0) {
+        d[i][j] = i + j;
+        continue;
+      }
+
+      size_t best = d[i - 1][j - 1] + (a[i - 1] != b[j - 1]);
+      best = d[i - 1][j] + 1 < best ? d[i - 1][j] + 1 : best;
+      best = d[i][j - 1] + 1 < best ? d[i][j - 1] + 1 : best;
+      d[i][j] = best;
+    }
+  }
+  return d[alen][blen];
+}
+
+static int Test_FlagsSuggest(void) {
+  char a[24];
+  char b[24];
+  srand(7);
+  for (int round = 0; round < 2000; round++) {
+    const size_t alen = (size_t)rand() / (RAND_MAX / 20 + 1);
+    const size_t blen = (size_t)rand() / (RAND_MAX / 20 + 1);
+    for (size_t i = 0; i < alen; i++) {
+      a[i] = (char)('a' + rand() / (RAND_MAX / 3 + 1));
+    }
+    for (size_t i = 0; i < blen; i++) {
+      b[i] = (char)('a' + rand() / (RAND_MAX / 3 + 1));
+    }
+
+    FlagsMatcher matcher;
+    FlagsMatcherInit(&matcher, a, alen);
+    AssertEq(FlagsMatcherDistance(&matcher, b, blen),
+             TestEditDistance(a, alen, b, blen));
+  }
+
+  char longer[80];
+  memset(longer, 'x', sizeof(longer));
+  FlagsMatcher matcher;
+  FlagsMatcherInit(&matcher, longer, sizeof(longer));
+  AssertEq(FlagsMatcherDistance(&matcher, longer, 70), (size_t)10);
+
+  int64_t value = 0;
+  char cmd[16] = "";
+  FlagCommandsDeclare(cmds, cmd, 16, FlagNewCommand("status", "status"),
+                      FlagNewCommand("start", "start"));
+  FlagOptionsDeclare(options, FlagsNewInt64(&value, "listen", "listen"),
+                     FlagsNewInt64(&value, "limit", "limit"),
+                     FlagsNewInt64(&value, "verbosity", "verbosity"), );
+  Flags flags = FlagsDefine(options, cmds);
+  FlagSuggestion out[FlagsMaxSuggestions];
+  AssertEq(FlagsSuggest(&flags, "--limt=3", out, FlagsMaxSuggestions),
+           (size_t)1);
+  AssertStringEq(out[0].Name, "limit");
+  AssertEq(FlagsSuggest(&flags, "-Verbositty", out, FlagsMaxSuggestions),
+           (size_t)1);
+  AssertStringEq(out[0].Name, "verbosity");
+  AssertEq(FlagsSuggest(&flags, "stat", out, FlagsMaxSuggestions),
+           (size_t)2);
+  AssertStringEq(out[0].Name, "start");
+  AssertStringEq(out[1].Name, "status");
+  AssertEq(FlagsSuggest(&flags, "-xyz", out, FlagsMaxSuggestions), (size_t)0);
+
+  // names longer than a word share one row and stop early past max
+  char longName[71];
+  char farName[71];
+  char token[74] = "--";
+  memset(longName, 'x', 70);
+  memset(farName, 'y', 70);
+  memset(token + 2, 'x', 71);
+  longName[70] = farName[70] = token[73] = 0;
+  FlagOptionsDeclare(longOptions, FlagsNewInt64(&value, farName, "far"),
+                     FlagsNewInt64(&value, longName, "long"), );
+  Flags longFlags = FlagsDefineOnlyOptions(longOptions);
+  AssertEq(FlagsSuggest(&longFlags, token, out, FlagsMaxSuggestions),
+           (size_t)1);
+  AssertTrue(out[0].Name == longName);
+  AssertEq(out[0].Distance, (size_t)1);
+  return EXIT_SUCCESS;
+}
+
+static int Test_StringFindChar(void) {
+  const char *s = "0123456789abcdef,0123";
+  AssertTrue(StringFindChar(s, strlen(s), ',') == s + 16);
+  AssertTrue(StringFindChar(s, strlen(s), '3') == s + 3);
+  AssertTrue(StringFindChar(s, strlen(s), 'z') == s + strlen(s));
+  AssertTrue(StringFindChar(s, 16, ',') == s + 16);
+  return EXIT_SUCCESS;
+}
+
+static int Test_StringSkipClass(void) {
+  // every byte value at every position, so that each lane of the 16 and 8
+  // byte kernels and the scalar tail is checked against CharClassTable
+  char blanks[43];
+  char words[43];
+  for (size_t pos = 0; pos < sizeof(blanks); pos++) {
+    for (int b = 0; b < 256; b++) {
+      memset(blanks, ' ', sizeof(blanks));
+      memset(words, 'x', sizeof(words));
+      blanks[pos] = (char)b;
+      words[pos] = (char)b;
+
+      const bool blank = CharIsClass((char)b, CharClassBlank);
+      const size_t stop = blank ? sizeof(blanks) : pos;
+      AssertEq((size_t)(StringSkipBlank(blanks, sizeof(blanks)) - blanks),
+               stop);
+      const size_t word = blank ? pos : sizeof(words);
+      AssertEq((size_t)(StringSkipNonBlank(words, sizeof(words)) - words),
+               word);
+      const size_t line = b == '\n' ? pos : sizeof(words);
+      AssertEq((size_t)(StringSkipLine(words, sizeof(words)) - words), line);
+    }
+  }
+
+  const char *s = "\t\v\f\r \n#x";
+  AssertTrue(StringSkipClass(s, strlen(s), CharClassBlank) == s + 6);
+  AssertTrue(StringSkipNotClass(s, strlen(s), CharClassNewline) == s + 5);
+  AssertTrue(StringSkipBlank(s, 3) == s + 3);
+  AssertTrue(CharIsBlank('\v'));
+  AssertFalse(CharIsBlank('\0'));
+  AssertFalse(CharIsBlank((char)0xa0));
+  return EXIT_SUCCESS;
+}
+
+static int Test_StringParseInt64(void) {
+  int64_t value = 0;
+  const char *endptr = NULL;
+  const char *max = "9223372036854775807";
+  const char *min = "-9223372036854775808";
+
+  AssertEq(StringParseInt64(max, strlen(max), &value, &endptr), NumOk);
+  AssertEq(value, INT64_MAX);
+  AssertTrue(endptr == max + strlen(max));
+  AssertEq(StringParseInt64(min, strlen(min), &value, NULL), NumOk);
+  AssertEq(value, INT64_MIN);
+  AssertEq(StringParseInt64("9223372036854775808", 19, &value, NULL),
+           NumErrRange);
+  AssertEq(value, INT64_MAX);
+  AssertEq(StringParseInt64(" -1234567890123456x", 19, &value, &endptr),
+           NumOk);
+  AssertEq(value, -1234567890123456);
+  AssertEq(*endptr, 'x');
+  AssertEq(StringParseInt64("-", 1, &value, NULL), NumErrSyntax);
+  AssertEq(StringParseInt64("", 0, &value, NULL), NumErrSyntax);
+  return EXIT_SUCCESS;
+}
+
+static int Test_StringParseUint64(void) {
+  uint64_t value = 0;
+  const char *max = "18446744073709551615";
+  const char *zeros = "0000000000000000000000000000123";
+
+  AssertEq(StringParseUint64(max, strlen(max), &value, NULL), NumOk);
+  AssertEq(value, UINT64_MAX);
+  AssertEq(StringParseUint64("18446744073709551616", 20, &value, NULL),
+           NumErrRange);
+  AssertEq(StringParseUint64(zeros, strlen(zeros), &value, NULL), NumOk);
+  AssertEq(value, 123u);
+  AssertEq(StringParseUint64("-1", 2, &value, NULL), NumErrSyntax);
+  return EXIT_SUCCESS;
+}
+
+static int Test_ParseUnits(void) {
+  int64_t d = 0;
+  AssertTrue(ParseDuration(&d, "250ms", 5));
+  AssertEq(d, 250000000);
+  AssertTrue(ParseDuration(&d, "1h30m", 5));
+  AssertEq(d, 5400000000000);
+  AssertTrue(ParseDuration(&d, "-1.5us", 6));
+  AssertEq(d, -1500);
+  AssertTrue(ParseDuration(&d, "0", 1));
+  AssertEq(d, 0);
+  AssertFalse(ParseDuration(&d, "10", 2));
+  AssertFalse(ParseDuration(&d, "1d", 2));
+  AssertFalse(ParseDuration(&d, "2562048h", 8));
+  AssertTrue(ParseDuration(&d, "2562047h", 8));
+
+  uint64_t b = 0;
+  AssertTrue(ParseByteSize(&b, "64MiB", 5));
+  AssertEq(b, (uint64_t)64 << 20);
+  AssertTrue(ParseByteSize(&b, "2G", 2));
+  AssertEq(b, 2000000000u);
+  AssertTrue(ParseByteSize(&b, "1.5 kib", 7));
+  AssertEq(b, 1536u);
+  AssertTrue(ParseByteSize(&b, "512", 3));
+  AssertEq(b, 512u);
+  AssertTrue(ParseByteSize(&b, "15EiB", 5));
+  AssertEq(b, (uint64_t)15 << 60);
+  AssertFalse(ParseByteSize(&b, "16EiB", 5));
+  AssertFalse(ParseByteSize(&b, "-1K", 3));
+  AssertFalse(ParseByteSize(&b, "1X", 2));
+  AssertFalse(ParseByteSize(&b, "1.5", 3));
+  AssertFalse(ParseByteSize(&b, "1.1KiB", 6));
+  AssertTrue(ParseByteSize(&b, "0.25KiB", 7));
+  AssertEq(b, 256u);
+  AssertTrue(ParseByteSize(&b, "1.500000000000000000000MB", 25));
+  AssertEq(b, 1500000u);
+  AssertFalse(ParseByteSize(&b, "1.0000000000000000000001EiB", 27));
+  AssertTrue(ParseByteSize(&b, "2.0", 3));
+  AssertEq(b, 2u);
+
+  int64_t timeout = 0;
+  uint64_t cache = 0;
+  int index = -1;
+  char *argv[] = {"test", "-timeout", "1m", "-cache", "1KB"};
+  FlagOptionsDeclare(options,
+                     FlagsNewDuration(&timeout, "timeout", "timeout"),
+                     FlagsNewByteSize(&cache, "cache", "cache size"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  AssertNotError(FlagsParse(5, argv, &flags, &index));
+  AssertEq(timeout, 60000000000);
+  AssertEq(cache, 1000u);
+  return EXIT_SUCCESS;
+}
+
+static int Test_StringParseDouble(void) {
+  const char *cases[] = {
+      "0",
+      "-0.0",
+      "1.5e3",
+      "0.1",
+      "2.2250738585072011e-308",
+      "4.9406564584124654e-324",
+      "1.7976931348623157e308",
+      "9007199254740993",
+      "123456789012345678901234567890e-10",
+      "1.00000000000000011102230246251565404236316680908203125",
+      "7.3177701707893310e+15",
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    double value = 0;
+    const double expected = strtod(cases[i], NULL);
+    AssertEq(StringParseDouble(cases[i], strlen(cases[i]), &value, NULL),
+             NumOk);
+    AssertTrue(memcmp(&value, &expected, sizeof(value)) == 0);
+
+    float f = 0;
+    const float fexpected = strtof(cases[i], NULL);
+    if (fexpected != 0 && !isinf(fexpected)) {
+      AssertEq(StringParseFloat(cases[i], strlen(cases[i]), &f, NULL), NumOk);
+      AssertTrue(memcmp(&f, &fexpected, sizeof(f)) == 0);
+    }
+  }
+
+  double value = 0;
+  const char *endptr = NULL;
+  AssertEq(StringParseDouble(" -Infinity", 10, &value, NULL), NumOk);
+  AssertTrue(isinf(value) && value < 0);
+  AssertEq(StringParseDouble("nan", 3, &value, NULL), NumOk);
+  AssertTrue(isnan(value));
+  AssertEq(StringParseDouble("1e400", 5, &value, NULL), NumErrRange);
+  AssertEq(StringParseDouble("2.5e", 4, &value, &endptr), NumOk);
+  AssertTrue(value == 2.5 && *endptr == 'e');
+  AssertEq(StringParseDouble(".", 1, &value, NULL), NumErrSyntax);
+
+  double ratio = 0;
+  int index = -1;
+  char *argv[] = {"test", "-ratio", "0.75"};
+  FlagOptionsDeclare(options, FlagsNewDouble(&ratio, "ratio", "ratio"), );
+  Flags flags = FlagsDefineOnlyOptions(options);
+  AssertNotError(FlagsParse(3, argv, &flags, &index));
+  AssertTrue(ratio == 0.75);
+  return EXIT_SUCCESS;
+}
+
+static int Test_ParseIntegers(void) {
+  int32_t int32Value = 0;
+  uint32_t uint32Value = 0;
+  int64_t int64Value = 0;
+
+  AssertTrue(ParseInt32(&int32Value, "-2147483648", 11));
+  AssertEq(int32Value, INT32_MIN);
+  AssertFalse(ParseInt32(&int32Value, "2147483648", 10));
+  AssertTrue(ParseUint32(&uint32Value, "4294967295", 10));
+  AssertEq(uint32Value, UINT32_MAX);
+  AssertFalse(ParseUint32(&uint32Value, "4294967296", 10));
+  AssertTrue(ParseInt64(&int64Value, "42 ", 3));
+  AssertEq(int64Value, 42);
+  AssertFalse(ParseInt64(&int64Value, "12x", 3));
+  AssertFalse(ParseInt64(&int64Value, "", 0));
+  return EXIT_SUCCESS;
+}
+
 int main() {
   TestRun(Test_FlagsStringFlag);
   TestRun(Test_FlagsBoolFlag);
@@ -267,6 +1749,34 @@ int main() {
   TestRun(Test_FlagsCommandOnly);
   TestRun(Test_FlagsCommandWithOption);
   TestRun(Test_FlagsCommandUnknown);
+  TestRun(Test_FlagsCompiled);
+  TestRun(Test_FlagsCompileDuplicate);
+  TestRun(Test_FlagsStringViewFlag);
+  TestRun(Test_FlagsResponseFile);
+  TestRun(Test_FlagsParseEnv);
+  TestRun(Test_FlagsListFlags);
+  TestRun(Test_FlagsParseBatch);
+  TestRun(Test_FlagsLazy);
+  TestRun(Test_FlagsReloader);
+  TestRun(Test_FlagsControl);
+  TestRun(Test_FlagsFormatHelp);
+  TestRun(Test_FlagsSchema);
+  TestRun(Test_FlagsEnum);
+  TestRun(Test_FlagsGnuSyntax);
+  TestRun(Test_FlagsTree);
+  TestRun(Test_FlagsStats);
+  TestRun(Test_FlagsSerialize);
+  TestRun(Test_FlagsShared);
+  TestRun(Test_FlagsRules);
+  TestRun(Test_FlagsComplete);
+  TestRun(Test_FlagsSuggest);
+  TestRun(Test_StringFindChar);
+  TestRun(Test_StringSkipClass);
+  TestRun(Test_StringParseInt64);
+  TestRun(Test_StringParseUint64);
+  TestRun(Test_ParseIntegers);
+  TestRun(Test_StringParseDouble);
+  TestRun(Test_ParseUnits);
 
   return EXIT_SUCCESS;
 }